@@ -0,0 +1,228 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "DumpCatalog.h"
+
+namespace {
+	// A catalog file is c_szCatalogMagic followed by the columns in the order of ForEachColumn.
+	// Each column is a std::uint64_t byte count followed by the column's elements.
+	constexpr char c_szCatalogMagic[] = "tcdmpcat01";
+
+	template<typename Catalog, typename Func>
+	void ForEachColumn(Catalog& catalog, Func fn) MAYTHROW {
+		fn(catalog.m_dumps.m_colstrPath.m_vecichEnd);
+		fn(catalog.m_dumps.m_colstrPath.m_vecch);
+		fn(catalog.m_dumps.m_vecnModificationTime);
+		fn(catalog.m_dumps.m_veccbFile);
+		fn(catalog.m_dumps.m_colstrExecutable.m_vecichEnd);
+		fn(catalog.m_dumps.m_colstrExecutable.m_vecch);
+		fn(catalog.m_dumps.m_colstrBundleVersion.m_vecichEnd);
+		fn(catalog.m_dumps.m_colstrBundleVersion.m_vecch);
+		fn(catalog.m_dumps.m_vecnThread);
+		fn(catalog.m_dumps.m_veciModuleEnd);
+		fn(catalog.m_dumps.m_vecnNanosecondsWrite);
+		fn(catalog.m_dumps.m_vecnRegions);
+		fn(catalog.m_dumps.m_veccbMapped);
+		fn(catalog.m_modules.m_veciDump);
+		fn(catalog.m_modules.m_colstrUuid.m_vecichEnd);
+		fn(catalog.m_modules.m_colstrUuid.m_vecch);
+		fn(catalog.m_modules.m_colstrVersion.m_vecichEnd);
+		fn(catalog.m_modules.m_colstrVersion.m_vecch);
+		fn(catalog.m_modules.m_colstrPath.m_vecichEnd);
+		fn(catalog.m_modules.m_colstrPath.m_vecch);
+		fn(catalog.m_veciModuleByUuid);
+		fn(catalog.m_veciDumpByBundleVersion);
+	}
+
+	template<typename Rng>
+	bool StringLess(Rng const& rngchLhs, Rng const& rngchRhs) noexcept {
+		return std::lexicographical_compare(tc::ptr_begin(rngchLhs), tc::ptr_end(rngchLhs), tc::ptr_begin(rngchRhs), tc::ptr_end(rngchRhs));
+	}
+
+	// Rows of vecirow, sorted by colstr, whose string equals str
+	tc::ptr_range<std::uint32_t const> EqualRows(tc::vector<std::uint32_t> const& vecirow, SDumpCatalog::SStringColumn const& colstr, tc::ptr_range<char const> str) noexcept {
+		auto const itBegin = std::partition_point(tc::ptr_begin(vecirow), tc::ptr_end(vecirow), [&](std::uint32_t irow) noexcept {
+			return StringLess(colstr[irow], str);
+		});
+		auto const itEnd = std::partition_point(itBegin, tc::ptr_end(vecirow), [&](std::uint32_t irow) noexcept {
+			return !StringLess(str, colstr[irow]);
+		});
+		return tc::make_iterator_range(itBegin, itEnd);
+	}
+
+	// The writer formats uuids in lower case, the uuid index and lldb in upper case. The catalog stores them in upper case.
+	std::basic_string<char> UpperCaseUuid(tc::ptr_range<char const> strUuid) noexcept {
+		return tc::make_str(tc::transform(strUuid, [](char ch) noexcept { return tc::explicit_cast<char>(std::toupper(ch)); }));
+	}
+
+	tc::vector<std::uint32_t> SortedRows(SDumpCatalog::SStringColumn const& colstr) noexcept {
+		auto vecirow = tc::make_vector(tc::iota(std::uint32_t(0), tc::explicit_cast<std::uint32_t>(tc::size(colstr))));
+		std::stable_sort(tc::begin(vecirow), tc::end(vecirow), [&](std::uint32_t irowLhs, std::uint32_t irowRhs) noexcept {
+			return StringLess(colstr[irowLhs], colstr[irowRhs]);
+		});
+		return vecirow;
+	}
+}
+
+void SDumpCatalog::AppendDump(tc::ptr_range<char const> strPath, std::int64_t nModificationTime, std::uint64_t cbFile, SDumpMetaInformation const& dumpmetainfo) & noexcept {
+	auto const iDump = tc::explicit_cast<std::uint32_t>(tc::size(m_dumps));
+	m_dumps.m_colstrPath.Append(strPath);
+	tc::cont_emplace_back(m_dumps.m_vecnModificationTime, nModificationTime);
+	tc::cont_emplace_back(m_dumps.m_veccbFile, cbFile);
+	m_dumps.m_colstrExecutable.Append(dumpmetainfo.m_strExecutable);
+	m_dumps.m_colstrBundleVersion.Append(dumpmetainfo.m_strBundleVersion);
+	tc::cont_emplace_back(m_dumps.m_vecnThread, dumpmetainfo.m_nThread);
+
+	tc::for_each(dumpmetainfo.m_vecmodule, [&](SDumpMetaInformation::SModule const& module) noexcept {
+		tc::cont_emplace_back(m_modules.m_veciDump, iDump);
+		m_modules.m_colstrUuid.Append(UpperCaseUuid(module.m_strUuid));
+		m_modules.m_colstrVersion.Append(tc::make_str(module.m_modver));
+		m_modules.m_colstrPath.Append(module.m_strPath);
+	});
+	tc::cont_emplace_back(m_dumps.m_veciModuleEnd, tc::explicit_cast<std::uint32_t>(tc::size(m_modules)));
+
+	if(auto const& odumpstats = dumpmetainfo.m_odumpstats) {
+		tc::cont_emplace_back(m_dumps.m_vecnNanosecondsWrite, odumpstats->m_nNanosecondsSuspend + odumpstats->m_nNanosecondsThreads + odumpstats->m_nNanosecondsDyldInfo
+			+ odumpstats->m_nNanosecondsModules + odumpstats->m_nNanosecondsRegions + odumpstats->m_nNanosecondsSegments);
+		tc::cont_emplace_back(m_dumps.m_vecnRegions, odumpstats->m_nRegions);
+		tc::cont_emplace_back(m_dumps.m_veccbMapped, odumpstats->m_cbMapped);
+	} else {
+		tc::cont_emplace_back(m_dumps.m_vecnNanosecondsWrite, 0);
+		tc::cont_emplace_back(m_dumps.m_vecnRegions, 0);
+		tc::cont_emplace_back(m_dumps.m_veccbMapped, 0);
+	}
+}
+
+void SDumpCatalog::AppendDump(SDumpCatalog const& catalog, std::size_t iDump) & noexcept {
+	auto const iDumpNew = tc::explicit_cast<std::uint32_t>(tc::size(m_dumps));
+	m_dumps.m_colstrPath.Append(catalog.m_dumps.m_colstrPath[iDump]);
+	tc::cont_emplace_back(m_dumps.m_vecnModificationTime, catalog.m_dumps.m_vecnModificationTime[iDump]);
+	tc::cont_emplace_back(m_dumps.m_veccbFile, catalog.m_dumps.m_veccbFile[iDump]);
+	m_dumps.m_colstrExecutable.Append(catalog.m_dumps.m_colstrExecutable[iDump]);
+	m_dumps.m_colstrBundleVersion.Append(catalog.m_dumps.m_colstrBundleVersion[iDump]);
+	tc::cont_emplace_back(m_dumps.m_vecnThread, catalog.m_dumps.m_vecnThread[iDump]);
+
+	auto const iModuleBegin = 0 == iDump ? 0 : catalog.m_dumps.m_veciModuleEnd[iDump-1];
+	tc::for_each(tc::iota(iModuleBegin, catalog.m_dumps.m_veciModuleEnd[iDump]), [&](std::uint32_t iModule) noexcept {
+		tc::cont_emplace_back(m_modules.m_veciDump, iDumpNew);
+		m_modules.m_colstrUuid.Append(UpperCaseUuid(catalog.m_modules.m_colstrUuid[iModule])); // catalogs written before uuids were normalized
+		m_modules.m_colstrVersion.Append(catalog.m_modules.m_colstrVersion[iModule]);
+		m_modules.m_colstrPath.Append(catalog.m_modules.m_colstrPath[iModule]);
+	});
+	tc::cont_emplace_back(m_dumps.m_veciModuleEnd, tc::explicit_cast<std::uint32_t>(tc::size(m_modules)));
+
+	tc::cont_emplace_back(m_dumps.m_vecnNanosecondsWrite, catalog.m_dumps.m_vecnNanosecondsWrite[iDump]);
+	tc::cont_emplace_back(m_dumps.m_vecnRegions, catalog.m_dumps.m_vecnRegions[iDump]);
+	tc::cont_emplace_back(m_dumps.m_veccbMapped, catalog.m_dumps.m_veccbMapped[iDump]);
+}
+
+void SDumpCatalog::BuildIndexes() & noexcept {
+	m_veciModuleByUuid = SortedRows(m_modules.m_colstrUuid);
+	m_veciDumpByBundleVersion = SortedRows(m_dumps.m_colstrBundleVersion);
+}
+
+tc::vector<std::uint32_t> SDumpCatalog::DumpsWithModule(tc::ptr_range<char const> strUuid) const& noexcept {
+	// A dump lists each module once, so the dumps are unique
+	auto veciDump = tc::make_vector(tc::transform(EqualRows(m_veciModuleByUuid, m_modules.m_colstrUuid, UpperCaseUuid(strUuid)), [&](std::uint32_t iModule) noexcept {
+		return m_modules.m_veciDump[iModule];
+	}));
+	tc::sort_inplace(veciDump);
+	return veciDump;
+}
+
+tc::ptr_range<std::uint32_t const> SDumpCatalog::DumpsWithBundleVersion(tc::ptr_range<char const> strBundleVersion) const& noexcept {
+	return EqualRows(m_veciDumpByBundleVersion, m_dumps.m_colstrBundleVersion, strBundleVersion);
+}
+
+SDumpCatalog SDumpCatalog::Load(char const* szFile) THROW(tc::file_failure, ExLoadFail) {
+	SFileMapping filemapping(szFile); // THROW(tc::file_failure)
+	tc::ptr_range<unsigned char const> rngbyte = filemapping;
+
+	auto Take = [&](std::uint64_t cb) THROW(ExLoadFail) {
+		if(tc::size(rngbyte) < cb) {
+			throw ExLoadFail();
+		}
+		auto const rngbyteTaken = tc::take_first(rngbyte, cb);
+		tc::drop_first_inplace(rngbyte, cb);
+		return rngbyteTaken;
+	};
+
+	if(!tc::equal(tc::as_typed_range<char>(Take(sizeof(c_szCatalogMagic) - 1)), tc::as_c_str(c_szCatalogMagic))) { // THROW(ExLoadFail)
+		throw ExLoadFail();
+	}
+
+	SDumpCatalog catalog;
+	ForEachColumn(catalog, [&](auto& vec) THROW(ExLoadFail) {
+		using T = tc::range_value_t<std::remove_reference_t<decltype(vec)>>;
+		std::uint64_t cb;
+		std::memcpy(std::addressof(cb), tc::ptr_begin(Take(sizeof(cb))), sizeof(cb)); // THROW(ExLoadFail)
+		if(0 != cb % sizeof(T)) {
+			throw ExLoadFail();
+		}
+		auto const rngbyteColumn = Take(cb); // THROW(ExLoadFail)
+		vec.resize(cb / sizeof(T));
+		std::memcpy(vec.data(), tc::ptr_begin(rngbyteColumn), cb);
+	}); // THROW(ExLoadFail)
+
+	// Reject catalogs whose columns disagree, the accessors do not check
+	auto const cDumps = tc::size(catalog.m_dumps);
+	auto const cModules = tc::size(catalog.m_modules);
+	auto IsValid = [](SStringColumn const& colstr, std::size_t cRows) noexcept {
+		return cRows == tc::size(colstr)
+			&& std::is_sorted(tc::begin(colstr.m_vecichEnd), tc::end(colstr.m_vecichEnd))
+			&& (0 == cRows || tc::back(colstr.m_vecichEnd) == tc::size(colstr.m_vecch));
+	};
+	if(!(IsValid(catalog.m_dumps.m_colstrPath, cDumps)
+		&& cDumps == tc::size(catalog.m_dumps.m_vecnModificationTime)
+		&& cDumps == tc::size(catalog.m_dumps.m_veccbFile)
+		&& IsValid(catalog.m_dumps.m_colstrExecutable, cDumps)
+		&& IsValid(catalog.m_dumps.m_colstrBundleVersion, cDumps)
+		&& cDumps == tc::size(catalog.m_dumps.m_vecnThread)
+		&& cDumps == tc::size(catalog.m_dumps.m_veciModuleEnd)
+		&& std::is_sorted(tc::begin(catalog.m_dumps.m_veciModuleEnd), tc::end(catalog.m_dumps.m_veciModuleEnd))
+		&& (0 == cDumps || tc::back(catalog.m_dumps.m_veciModuleEnd) == cModules)
+		&& cDumps == tc::size(catalog.m_dumps.m_vecnNanosecondsWrite)
+		&& cDumps == tc::size(catalog.m_dumps.m_vecnRegions)
+		&& cDumps == tc::size(catalog.m_dumps.m_veccbMapped)
+		&& tc::all_of(catalog.m_modules.m_veciDump, [&](std::uint32_t iDump) noexcept { return iDump < cDumps; })
+		&& IsValid(catalog.m_modules.m_colstrUuid, cModules)
+		&& IsValid(catalog.m_modules.m_colstrVersion, cModules)
+		&& IsValid(catalog.m_modules.m_colstrPath, cModules)
+		&& cModules == tc::size(catalog.m_veciModuleByUuid)
+		&& tc::all_of(catalog.m_veciModuleByUuid, [&](std::uint32_t iModule) noexcept { return iModule < cModules; })
+		&& cDumps == tc::size(catalog.m_veciDumpByBundleVersion)
+		&& tc::all_of(catalog.m_veciDumpByBundleVersion, [&](std::uint32_t iDump) noexcept { return iDump < cDumps; })
+	)) {
+		throw ExLoadFail();
+	}
+	return catalog;
+}
+
+void SDumpCatalog::Save(std::basic_string<char> const& strFile) const& THROW(tc::file_failure) {
+	tc::vector<unsigned char> vecbyte;
+	tc::append(vecbyte, tc::range_as_blob(tc::as_c_str(c_szCatalogMagic)));
+	ForEachColumn(*this, [&](auto const& vec) noexcept {
+		std::uint64_t const cb = tc::size(vec) * sizeof(tc::range_value_t<std::remove_reference_t<decltype(vec)>>);
+		tc::append(vecbyte, tc::as_blob(cb));
+		tc::append(vecbyte, tc::range_as_blob(vec));
+	});
+
+	auto const strFileTemp = tc::make_str(FilenameWithoutPath<tc::return_take>(strFile), tc::unique_name<SBase32CodeTable>());
+	try {
+		tc::append(tc::appendfile(tc::as_c_str(strFileTemp), tc::create_new_tag), vecbyte); // THROW(tc::file_failure)
+	} catch(tc::file_failure const&) {
+		tc::filesystem::remove_all(tc::as_c_str(strFileTemp));
+		throw;
+	}
+	boost::system::error_code ec;
+	boost::filesystem::rename(strFileTemp, strFile, ec);
+	if(ec) {
+		TRACE("Could not rename ", strFileTemp, " to ", strFile, ": ", ec.message());
+		tc::filesystem::remove_all(tc::as_c_str(strFileTemp));
+		throw tc::file_failure();
+	}
+}
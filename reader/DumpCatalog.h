@@ -0,0 +1,86 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+#include "DumpMetaInformation.h"
+
+// Catalog of the SDumpMetaInformation of all dumps in an archive, so questions like "which dumps loaded the module with uuid X"
+// can be answered without unzipping every dump. The catalog stores one table of dumps and one table of their modules.
+// Both tables are stored column by column, so a query only touches the columns it needs. Row numbers are std::uint32_t.
+struct SDumpCatalog final {
+	struct SStringColumn final {
+		tc::vector<std::uint64_t> m_vecichEnd; // string i ends at m_vecichEnd[i] and starts where string i-1 ends
+		tc::vector<char> m_vecch;
+
+		std::size_t size() const& noexcept {
+			return tc::size(m_vecichEnd);
+		}
+
+		tc::ptr_range<char const> operator[](std::size_t i) const& noexcept {
+			auto const ichBegin = 0 == i ? 0 : m_vecichEnd[i-1];
+			return tc::counted(m_vecch.data() + ichBegin, m_vecichEnd[i] - ichBegin);
+		}
+
+		void Append(tc::ptr_range<char const> str) & noexcept {
+			tc::append(m_vecch, str);
+			tc::cont_emplace_back(m_vecichEnd, tc::size(m_vecch));
+		}
+	};
+
+	// One row per dump file
+	struct SDumps final {
+		SStringColumn m_colstrPath;
+		tc::vector<std::int64_t> m_vecnModificationTime; // of the dump file, seconds since the epoch
+		tc::vector<std::uint64_t> m_veccbFile;
+		SStringColumn m_colstrExecutable;
+		SStringColumn m_colstrBundleVersion;
+		tc::vector<std::int32_t> m_vecnThread;
+		tc::vector<std::uint32_t> m_veciModuleEnd; // the modules of dump i are the module rows from m_veciModuleEnd[i-1] to m_veciModuleEnd[i]
+		// From SDumpStatistics, all zero for dumps without statistics
+		tc::vector<std::uint64_t> m_vecnNanosecondsWrite; // sum of all phases of MiniDumpWriteDump
+		tc::vector<std::uint64_t> m_vecnRegions;
+		tc::vector<std::uint64_t> m_veccbMapped;
+
+		std::size_t size() const& noexcept {
+			return tc::size(m_colstrPath);
+		}
+	};
+	SDumps m_dumps;
+
+	// One row per module of each dump
+	struct SModules final {
+		tc::vector<std::uint32_t> m_veciDump;
+		SStringColumn m_colstrUuid;
+		SStringColumn m_colstrVersion;
+		SStringColumn m_colstrPath;
+
+		std::size_t size() const& noexcept {
+			return tc::size(m_veciDump);
+		}
+	};
+	SModules m_modules;
+
+	// Row numbers sorted by the indexed column, rows with equal values in row order. Call BuildIndexes after appending dumps.
+	tc::vector<std::uint32_t> m_veciModuleByUuid;
+	tc::vector<std::uint32_t> m_veciDumpByBundleVersion;
+
+	void AppendDump(tc::ptr_range<char const> strPath, std::int64_t nModificationTime, std::uint64_t cbFile, SDumpMetaInformation const& dumpmetainfo) & noexcept;
+	// Appends dump iDump of catalog, e.g., to keep dumps that did not change when updating the catalog
+	void AppendDump(SDumpCatalog const& catalog, std::size_t iDump) & noexcept;
+	void BuildIndexes() & noexcept;
+
+	// Dumps that loaded the module strUuid, in row order. Uuids are compared case-insensitively.
+	tc::vector<std::uint32_t> DumpsWithModule(tc::ptr_range<char const> strUuid) const& noexcept;
+	// Dumps written by strBundleVersion, in row order
+	tc::ptr_range<std::uint32_t const> DumpsWithBundleVersion(tc::ptr_range<char const> strBundleVersion) const& noexcept;
+
+	static SDumpCatalog Load(char const* szFile) THROW(tc::file_failure, ExLoadFail);
+	// Writes to a temporary file first, so concurrent readers see either the old or the new catalog
+	void Save(std::basic_string<char> const& strFile) const& THROW(tc::file_failure);
+};
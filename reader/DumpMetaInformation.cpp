@@ -0,0 +1,22 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "DumpMetaInformation.h"
+
+SDumpMetaInformation LoadDumpMetaInformation(tc::ptr_range<unsigned char const> rngbyteDump) THROW(ExLoadFail) {
+	auto const rngbyteXml = tc::take(rngbyteDump, tc::search<tc::return_border_after>(rngbyteDump, tc::range_as_blob("</root>")));
+
+	SDumpMetaInformation dumpmetainfo;
+	// FIXME: Load SDumpMetaInformation from rngbyteXml. m_odumpstats is set iff the <m_dumpstats> element exists.
+	return dumpmetainfo;
+}
+
+tc::vector<SDumpMetaInformation::SRegion> LoadDumpRegions(tc::ptr_range<unsigned char const> rngbyteRegions) THROW(ExLoadFail) {
+	tc::vector<SDumpMetaInformation::SRegion> vecregion;
+	// FIXME: Load the <elem> elements of the <m_vecregion> element of rngbyteRegions. An empty rngbyteRegions has no regions.
+	return vecregion;
+}
@@ -0,0 +1,77 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+
+// Metadata written by MiniDumpWriteDump as XML in front of the core file
+struct SDumpMetaInformation final {
+	std::basic_string<char> m_strExecutable;
+	std::basic_string<char> m_strBundleVersion;
+	int m_nThread;
+
+	struct SModule final {
+		std::basic_string<char> m_strPath;
+		std::uint64_t m_pvStartAddress;
+		tc::native_module_version m_modver;
+		std::basic_string<char> m_strUuid;
+	};
+	tc::vector<SModule> m_vecmodule;
+
+	// All regions of the task in address order, the mapped ones are in the core file. They are stored in the regions.xml entry
+	// of the zipped dump instead of the metadata in front of the core file, see LoadDumpRegions.
+	struct SRegion final {
+		std::uint64_t m_pvBegin;
+		std::uint64_t m_cb;
+		int m_nProtection; // VM_PROT_XXX
+		unsigned int m_nUserTag; // VM_MEMORY_XXX, see <mach/vm_statistics.h>
+		unsigned char m_nShareMode; // SM_XXX, see <mach/vm_region.h>
+		bool m_bMapped;
+	};
+
+	// See writer/DumpStatistics.h. Not present in dumps written by older versions.
+	struct SDumpStatistics final {
+		std::uint64_t m_nNanosecondsSuspend;
+		std::uint64_t m_nNanosecondsThreads;
+		std::uint64_t m_nNanosecondsDyldInfo;
+		std::uint64_t m_nNanosecondsModules;
+		std::uint64_t m_nNanosecondsRegions;
+		std::uint64_t m_nNanosecondsSegments;
+
+		std::uint64_t m_nRegions;
+		std::uint64_t m_nRegionsMapped;
+		std::uint64_t m_nRegionsSkipped;
+		std::uint64_t m_cbMapped;
+		std::uint64_t m_cbUnmapped;
+		std::uint64_t m_nRegionsOverBudget;
+		std::uint64_t m_cbOverBudget;
+		std::uint64_t m_nRegionsRemapFailed; // 0 in dumps written by older versions
+
+		std::uint64_t m_nCallsTaskThreads;
+		std::uint64_t m_nCallsThreadInfo;
+		std::uint64_t m_nCallsThreadGetState;
+		std::uint64_t m_nCallsTaskInfo;
+		std::uint64_t m_nCallsVmReadOverwrite;
+		std::uint64_t m_nCallsVmRegion;
+		std::uint64_t m_nCallsVmRegionRecurse;
+		std::uint64_t m_nCallsVmRemap;
+
+		struct SUserTag final {
+			unsigned int m_nUserTag;
+			std::uint64_t m_cb;
+			std::uint64_t m_cbMapped;
+		};
+		tc::vector<SUserTag> m_vecusertag;
+	};
+	std::optional<SDumpStatistics> m_odumpstats;
+};
+
+// rngbyteDump is the unzipped minidump.dmp
+SDumpMetaInformation LoadDumpMetaInformation(tc::ptr_range<unsigned char const> rngbyteDump) THROW(ExLoadFail);
+// rngbyteRegions is the unzipped regions.xml, or empty for dumps written by older versions, which do not have it
+tc::vector<SDumpMetaInformation::SRegion> LoadDumpRegions(tc::ptr_range<unsigned char const> rngbyteRegions) THROW(ExLoadFail);
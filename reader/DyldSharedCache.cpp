@@ -0,0 +1,421 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "DyldSharedCache.h"
+#include "tc/range.h"
+
+namespace {
+	using namespace macho;
+
+	bool IsDyldSharedCache(tc::ptr_range<unsigned char const> rngbyte) noexcept {
+		return tc::starts_with<tc::return_bool>(tc::as_typed_range<char>(rngbyte), "dyld_v1");
+	}
+
+	std::optional<tc::vector<dyld_cache_mapping_info>> Mappings(tc::ptr_range<unsigned char const> rngbyte) noexcept {
+		auto const oheader = Read<dyld_cache_header>(rngbyte, 0);
+		if(!oheader) {
+			return std::nullopt;
+		}
+		tc::vector<dyld_cache_mapping_info> vecmapping;
+		for(std::uint32_t iMapping = 0; iMapping < oheader->mappingCount; ++iMapping) {
+			auto const omapping = Read<dyld_cache_mapping_info>(rngbyte, oheader->mappingOffset + std::uint64_t(iMapping) * sizeof(dyld_cache_mapping_info));
+			if(!omapping || tc::size(rngbyte) < omapping->fileOffset || tc::size(rngbyte) - omapping->fileOffset < omapping->size) {
+				return std::nullopt;
+			}
+			tc::cont_emplace_back(vecmapping, *omapping);
+		}
+		return vecmapping;
+	}
+
+	std::optional<std::basic_string<char>> ReadCString(tc::ptr_range<unsigned char const> rngbyte, std::uint64_t ib) noexcept {
+		if(tc::size(rngbyte) <= ib) {
+			return std::nullopt;
+		}
+		auto const rngch = tc::as_typed_range<char>(tc::drop_first(rngbyte, ib));
+		auto const itchNul = std::find(tc::begin(rngch), tc::end(rngch), '\0');
+		if(tc::end(rngch) == itchNul) {
+			return std::nullopt;
+		}
+		return std::basic_string<char>(tc::begin(rngch), itchNul);
+	}
+
+	std::uint64_t RoundUp(std::uint64_t n, std::uint64_t nAlignment) noexcept {
+		return (n + nAlignment - 1) / nAlignment * nAlignment;
+	}
+
+	template<typename T>
+	void Write(tc::vector<unsigned char>& vecbyte, std::uint64_t ib, T const& t) noexcept {
+		_ASSERT(ib + sizeof(T) <= tc::size(vecbyte));
+		std::memcpy(tc::ptr_begin(vecbyte) + ib, std::addressof(t), sizeof(T));
+	}
+}
+
+std::optional<SDyldSharedCache> SDyldSharedCache::Open(std::basic_string<char> const& strPath) THROW(tc::file_failure) {
+	SDyldSharedCache dyldcache;
+
+	auto AddFile = [&](std::basic_string<char> const& strFile) THROW(tc::file_failure) {
+		SFileMapping filemapping(tc::as_c_str(strFile)); // THROW(tc::file_failure)
+		if(!IsDyldSharedCache(filemapping)) {
+			return false;
+		}
+		auto ovecmapping = Mappings(filemapping);
+		if(!ovecmapping) {
+			TRACE("Invalid mappings in dyld shared cache ", strFile);
+			return false;
+		}
+		tc::cont_emplace_back(dyldcache.m_vecfile, SFile{tc_move(filemapping), tc_move(*ovecmapping)});
+		return true;
+	};
+
+	if(!AddFile(strPath)) { // THROW(tc::file_failure)
+		return std::nullopt;
+	}
+
+	// Sub caches are the files next to the main cache whose name has an additional extension, except for the .map text file
+	// and the .symbols file that contains the unmapped local symbols
+	auto const pathMain = boost::filesystem::path(strPath);
+	auto const strPrefix = tc::make_str(pathMain.filename().string(), ".");
+	tc::vector<std::basic_string<char>> vecstrSubCache;
+	tc::for_each(boost::filesystem::directory_iterator(pathMain.parent_path()), [&](boost::filesystem::directory_entry const& direntry) noexcept {
+		auto const strFilename = direntry.path().filename().string();
+		if(tc::starts_with<tc::return_bool>(strFilename, strPrefix)
+		&& !tc::ends_with<tc::return_bool>(strFilename, ".map")
+		&& !tc::ends_with<tc::return_bool>(strFilename, ".symbols")
+		&& boost::filesystem::is_regular_file(direntry)) {
+			tc::cont_emplace_back(vecstrSubCache, direntry.path().string());
+		}
+	});
+	tc::sort_inplace(vecstrSubCache);
+	tc::for_each(vecstrSubCache, [&](std::basic_string<char> const& strSubCache) THROW(tc::file_failure) {
+		AddFile(strSubCache); // THROW(tc::file_failure)
+	});
+
+	auto const& rngbyteMain = tc::front(dyldcache.m_vecfile).m_filemapping;
+	auto const oheader = Read<dyld_cache_header>(rngbyteMain, 0);
+	_ASSERT(oheader); // checked by Mappings
+
+	// The image array moved when macOS 12 split the cache. Old caches have a header that ends before the new fields.
+	std::uint32_t ibImages = oheader->imagesOffsetOld;
+	std::uint32_t cImages = oheader->imagesCountOld;
+	if(c_nOffsetDyldCacheImagesCount + sizeof(std::uint32_t) <= oheader->mappingOffset) {
+		ibImages = *VERIFY(Read<std::uint32_t>(rngbyteMain, c_nOffsetDyldCacheImagesOffset));
+		cImages = *VERIFY(Read<std::uint32_t>(rngbyteMain, c_nOffsetDyldCacheImagesCount));
+	}
+	for(std::uint32_t iImage = 0; iImage < cImages; ++iImage) {
+		auto const oimageinfo = Read<dyld_cache_image_info>(rngbyteMain, ibImages + std::uint64_t(iImage) * sizeof(dyld_cache_image_info));
+		if(!oimageinfo) {
+			TRACE("Image array out of bounds in dyld shared cache ", strPath);
+			return std::nullopt;
+		}
+		auto ostrPath = ReadCString(rngbyteMain, oimageinfo->pathFileOffset);
+		if(!ostrPath) {
+			TRACE("Image path out of bounds in dyld shared cache ", strPath);
+			return std::nullopt;
+		}
+		tc::cont_emplace_back(dyldcache.m_vecimage, SImage{oimageinfo->address, tc_move(*ostrPath)});
+	}
+
+	// Caches with symbolFileUUID use 64 bit local symbol entries and usually keep the local symbols in the .symbols file
+	bool const bSymbolFileUuid = c_nOffsetDyldCacheSymbolFileUuid + 16 <= oheader->mappingOffset;
+	dyldcache.m_bLocalSymbolsEntries64 = bSymbolFileUuid;
+	if(bSymbolFileUuid && 0 == oheader->localSymbolsSize) {
+		auto const strSymbols = tc::make_str(strPath, ".symbols");
+		boost::system::error_code ec;
+		if(boost::filesystem::is_regular_file(strSymbols, ec)) {
+			SFileMapping filemapping(tc::as_c_str(strSymbols)); // THROW(tc::file_failure)
+			auto const oheaderSymbols = Read<dyld_cache_header>(filemapping, 0);
+			auto const oauuidSymbolFile = Read<std::array<std::uint8_t, 16>>(rngbyteMain, c_nOffsetDyldCacheSymbolFileUuid);
+			if(IsDyldSharedCache(filemapping) && oheaderSymbols && oauuidSymbolFile && 0 == std::memcmp(oheaderSymbols->uuid, oauuidSymbolFile->data(), 16)) {
+				dyldcache.m_ibLocalSymbols = oheaderSymbols->localSymbolsOffset;
+				dyldcache.m_cbLocalSymbols = oheaderSymbols->localSymbolsSize;
+				dyldcache.m_ofilemappingSymbols.emplace(tc_move(filemapping));
+			} else {
+				TRACE("Symbols file ", strSymbols, " does not belong to dyld shared cache ", strPath);
+			}
+		}
+	} else {
+		dyldcache.m_ibLocalSymbols = oheader->localSymbolsOffset;
+		dyldcache.m_cbLocalSymbols = oheader->localSymbolsSize;
+	}
+	return dyldcache;
+}
+
+tc::ptr_range<unsigned char const> SDyldSharedCache::Memory(std::uint64_t pv) const& noexcept {
+	for(auto const& file : m_vecfile) {
+		for(auto const& mapping : file.m_vecmapping) {
+			if(mapping.address <= pv && pv < mapping.address + mapping.size) {
+				tc::ptr_range<unsigned char const> rngbyte = file.m_filemapping;
+				return tc::counted(tc::ptr_begin(rngbyte) + mapping.fileOffset + (pv - mapping.address), mapping.size - (pv - mapping.address));
+			}
+		}
+	}
+	return {};
+}
+
+std::pair<tc::ptr_range<unsigned char const>, tc::ptr_range<unsigned char const>> SDyldSharedCache::LocalSymbols(std::uint64_t pvHeader) const& noexcept {
+	tc::ptr_range<unsigned char const> rngbyteFile = tc::front(m_vecfile).m_filemapping;
+	if(m_ofilemappingSymbols) {
+		rngbyteFile = *m_ofilemappingSymbols;
+	}
+	auto const& vecmappingMain = tc::front(m_vecfile).m_vecmapping;
+	if(0 == m_cbLocalSymbols || tc::empty(vecmappingMain) || pvHeader < tc::front(vecmappingMain).address) {
+		return {};
+	}
+	if(tc::size(rngbyteFile) < m_ibLocalSymbols || tc::size(rngbyteFile) - m_ibLocalSymbols < m_cbLocalSymbols) {
+		TRACE("Local symbols out of bounds in dyld shared cache");
+		return {};
+	}
+	auto const rngbyteInfo = tc::take_first(tc::drop_first(rngbyteFile, m_ibLocalSymbols), m_cbLocalSymbols);
+	auto const oinfo = Read<dyld_cache_local_symbols_info>(rngbyteInfo, 0);
+	if(!oinfo) {
+		return {};
+	}
+
+	auto const ibDylib = pvHeader - tc::front(vecmappingMain).address;
+	for(std::uint32_t iEntry = 0; iEntry < oinfo->entriesCount; ++iEntry) {
+		std::uint64_t ibDylibEntry;
+		std::uint32_t iSymbolStart;
+		std::uint32_t nSymbols;
+		if(m_bLocalSymbolsEntries64) {
+			auto const oentry = Read<dyld_cache_local_symbols_entry_64>(rngbyteInfo, oinfo->entriesOffset + std::uint64_t(iEntry) * sizeof(dyld_cache_local_symbols_entry_64));
+			if(!oentry) return {};
+			ibDylibEntry = oentry->dylibOffset;
+			iSymbolStart = oentry->nlistStartIndex;
+			nSymbols = oentry->nlistCount;
+		} else {
+			auto const oentry = Read<dyld_cache_local_symbols_entry>(rngbyteInfo, oinfo->entriesOffset + std::uint64_t(iEntry) * sizeof(dyld_cache_local_symbols_entry));
+			if(!oentry) return {};
+			ibDylibEntry = oentry->dylibOffset;
+			iSymbolStart = oentry->nlistStartIndex;
+			nSymbols = oentry->nlistCount;
+		}
+		if(ibDylib == ibDylibEntry) {
+			auto const ibSymbols = oinfo->nlistOffset + std::uint64_t(iSymbolStart) * sizeof(nlist_64);
+			auto const cbSymbols = std::uint64_t(nSymbols) * sizeof(nlist_64);
+			if(oinfo->nlistCount < iSymbolStart || oinfo->nlistCount - iSymbolStart < nSymbols
+			|| tc::size(rngbyteInfo) < ibSymbols || tc::size(rngbyteInfo) - ibSymbols < cbSymbols
+			|| tc::size(rngbyteInfo) < oinfo->stringsOffset || tc::size(rngbyteInfo) - oinfo->stringsOffset < oinfo->stringsSize) {
+				TRACE("Local symbols out of bounds in dyld shared cache");
+				return {};
+			}
+			return std::make_pair(
+				tc::take_first(tc::drop_first(rngbyteInfo, ibSymbols), cbSymbols),
+				tc::take_first(tc::drop_first(rngbyteInfo, oinfo->stringsOffset), oinfo->stringsSize)
+			);
+		}
+	}
+	return {};
+}
+
+std::optional<tc::vector<unsigned char>> SDyldSharedCache::ExtractImage(std::uint64_t pvHeader) const& noexcept {
+	auto const rngbyteImage = Memory(pvHeader);
+	auto const oheader = Read<mach_header_64>(rngbyteImage, 0);
+	if(!oheader || c_nMagic64 != oheader->magic) {
+		return std::nullopt;
+	}
+
+	// Header and load commands are rewritten in place and copied over the start of __TEXT at the end
+	tc::vector<unsigned char> vecbyteHeader(tc::ptr_begin(rngbyteImage), tc::ptr_begin(rngbyteImage) + std::min<std::uint64_t>(sizeof(mach_header_64) + oheader->sizeofcmds, tc::size(rngbyteImage)));
+
+	tc::vector<std::uint64_t> vecibSegment;
+	std::optional<std::uint64_t> oibLinkedit;
+	std::optional<std::uint64_t> oibSymtab;
+	std::optional<std::uint64_t> oibDysymtab;
+	tc::vector<std::uint64_t> vecibLinkeditData; // linkedit_data_command and dyld_info_command
+	bool bMalformed = false;
+	if(!ForEachLoadCommand(vecbyteHeader, 0, [&](load_command const& loadcmd, std::uint64_t ibCommand) noexcept {
+		switch(loadcmd.cmd) {
+			case c_nLcSegment64:
+				// The segment commands collected here are read again below without checks
+				if(auto const osegcmd = Read<segment_command_64>(vecbyteHeader, ibCommand); !osegcmd) {
+					bMalformed = true;
+				} else if(0 == std::strncmp(osegcmd->segname, "__LINKEDIT", 16)) {
+					oibLinkedit = ibCommand;
+				} else {
+					tc::cont_emplace_back(vecibSegment, ibCommand);
+				}
+				break;
+			case c_nLcSymtab: oibSymtab = ibCommand; break;
+			case c_nLcDysymtab: oibDysymtab = ibCommand; break;
+			case c_nLcDyldInfo:
+			case c_nLcDyldInfoOnly:
+			case c_nLcFunctionStarts:
+			case c_nLcDataInCode:
+			case c_nLcDyldExportsTrie:
+			case c_nLcDyldChainedFixups:
+			case c_nLcCodeSignature:
+			case c_nLcSegmentSplitInfo:
+				tc::cont_emplace_back(vecibLinkeditData, ibCommand);
+				break;
+		}
+	}) || bMalformed || !oibLinkedit) {
+		return std::nullopt;
+	}
+
+	std::uint64_t const cbPage = c_nCpuTypeArm64 == static_cast<std::uint32_t>(oheader->cputype) ? 0x4000 : 0x1000;
+	tc::vector<unsigned char> vecbyteOut;
+
+	// Copy all segments except __LINKEDIT unchanged, each starting at a page boundary
+	for(auto const ibSegment : vecibSegment) {
+		auto segcmd = *Read<segment_command_64>(vecbyteHeader, ibSegment);
+		auto const rngbyteSegment = Memory(segcmd.vmaddr);
+		if(tc::size(rngbyteSegment) < segcmd.filesize) {
+			return std::nullopt;
+		}
+		auto const ibFile = RoundUp(tc::size(vecbyteOut), cbPage);
+		vecbyteOut.resize(ibFile);
+		tc::append(vecbyteOut, tc::take_first(rngbyteSegment, segcmd.filesize));
+
+		auto ibSection = ibSegment + sizeof(segment_command_64);
+		for(std::uint32_t iSection = 0; iSection < segcmd.nsects; ++iSection, ibSection += sizeof(section_64)) {
+			auto osection = Read<section_64>(vecbyteHeader, ibSection);
+			if(!osection) {
+				return std::nullopt;
+			}
+			auto const nSectionType = osection->flags & c_nSectionTypeMask;
+			if(c_nSectionZerofill != nSectionType && c_nSectionGbZerofill != nSectionType && c_nSectionThreadLocalZerofill != nSectionType) {
+				osection->offset = tc::explicit_cast<std::uint32_t>(ibFile + (osection->addr - segcmd.vmaddr));
+			}
+			Write(vecbyteHeader, ibSection, *osection);
+		}
+		segcmd.fileoff = ibFile;
+		Write(vecbyteHeader, ibSegment, segcmd);
+	}
+
+	// The link edit segment is shared by all images in the cache. Offsets in the load commands are file offsets relative to
+	// the file containing __LINKEDIT, so we translate them to addresses.
+	auto segcmdLinkedit = *Read<segment_command_64>(vecbyteHeader, *oibLinkedit);
+	auto LinkeditData = [&](std::uint64_t ib, std::uint64_t cb) noexcept -> std::optional<tc::ptr_range<unsigned char const>> {
+		if(0 == cb) {
+			return tc::ptr_range<unsigned char const>();
+		} else if(ib < segcmdLinkedit.fileoff) {
+			return std::nullopt;
+		}
+		auto const rngbyte = Memory(segcmdLinkedit.vmaddr + (ib - segcmdLinkedit.fileoff));
+		if(tc::size(rngbyte) < cb) {
+			return std::nullopt;
+		}
+		return tc::take_first(rngbyte, cb);
+	};
+
+	auto const ibLinkedit = RoundUp(tc::size(vecbyteOut), cbPage);
+	vecbyteOut.resize(ibLinkedit);
+	auto AppendLinkedit = [&](tc::ptr_range<unsigned char const> rngbyte) noexcept {
+		vecbyteOut.resize(RoundUp(tc::size(vecbyteOut), 8));
+		auto const ib = tc::size(vecbyteOut);
+		tc::append(vecbyteOut, rngbyte);
+		return tc::explicit_cast<std::uint32_t>(ib);
+	};
+
+	for(auto const ibCommand : vecibLinkeditData) {
+		auto const loadcmd = *Read<load_command>(vecbyteHeader, ibCommand);
+		if(c_nLcDyldInfo == loadcmd.cmd || c_nLcDyldInfoOnly == loadcmd.cmd) {
+			auto odyldinfocmd = Read<dyld_info_command>(vecbyteHeader, ibCommand);
+			if(!odyldinfocmd) return std::nullopt;
+			auto const orngbyteExport = LinkeditData(odyldinfocmd->export_off, odyldinfocmd->export_size);
+			if(!orngbyteExport) return std::nullopt;
+			dyld_info_command dyldinfocmd = {odyldinfocmd->cmd, odyldinfocmd->cmdsize};
+			if(0 != odyldinfocmd->export_size) {
+				dyldinfocmd.export_off = AppendLinkedit(*orngbyteExport);
+				dyldinfocmd.export_size = odyldinfocmd->export_size;
+			}
+			Write(vecbyteHeader, ibCommand, dyldinfocmd);
+		} else {
+			auto olinkeditdatacmd = Read<linkedit_data_command>(vecbyteHeader, ibCommand);
+			if(!olinkeditdatacmd) return std::nullopt;
+			if((c_nLcFunctionStarts == loadcmd.cmd || c_nLcDataInCode == loadcmd.cmd || c_nLcDyldExportsTrie == loadcmd.cmd) && 0 != olinkeditdatacmd->datasize) {
+				auto const orngbyte = LinkeditData(olinkeditdatacmd->dataoff, olinkeditdatacmd->datasize);
+				if(!orngbyte) return std::nullopt;
+				olinkeditdatacmd->dataoff = AppendLinkedit(*orngbyte);
+			} else {
+				olinkeditdatacmd->dataoff = 0;
+				olinkeditdatacmd->datasize = 0;
+			}
+			Write(vecbyteHeader, ibCommand, *olinkeditdatacmd);
+		}
+	}
+
+	if(oibSymtab) {
+		auto symtabcmd = *Read<symtab_command>(vecbyteHeader, *oibSymtab);
+		auto const orngbyteSymbols = LinkeditData(symtabcmd.symoff, std::uint64_t(symtabcmd.nsyms) * sizeof(nlist_64));
+		auto const orngbyteStrings = LinkeditData(symtabcmd.stroff, symtabcmd.strsize);
+		if(!orngbyteSymbols || !orngbyteStrings) return std::nullopt;
+
+		// The string pools are shared by all images. Copy only the strings our symbols refer to.
+		tc::vector<unsigned char> vecbyteStrings(2, '\0'); // n_strx 0 means no name, keep the usual leading " \0"
+		vecbyteStrings[0] = ' ';
+		tc::vector<nlist_64> vecnlist;
+		auto AppendSymbols = [&](tc::ptr_range<unsigned char const> rngbyteSymbols, std::uint64_t nSymbols, tc::ptr_range<unsigned char const> rngbyteStrings) noexcept {
+			for(std::uint64_t iSymbol = 0; iSymbol < nSymbols; ++iSymbol) {
+				auto nlist = *Read<nlist_64>(rngbyteSymbols, iSymbol * sizeof(nlist_64));
+				if(0 != nlist.n_strx) {
+					if(auto const ostrName = ReadCString(rngbyteStrings, nlist.n_strx)) {
+						nlist.n_strx = tc::explicit_cast<std::uint32_t>(tc::size(vecbyteStrings));
+						tc::append(vecbyteStrings, tc::range_as_blob(*ostrName));
+						tc::cont_emplace_back(vecbyteStrings, '\0');
+					} else {
+						nlist.n_strx = 0;
+					}
+				}
+				tc::cont_emplace_back(vecnlist, nlist);
+			}
+		};
+		// The local symbols go first, like in a linked dylib
+		auto const pairrngbyteLocal = LocalSymbols(pvHeader);
+		auto const nLocalSymbols = tc::explicit_cast<std::uint32_t>(tc::size(pairrngbyteLocal.first) / sizeof(nlist_64));
+		AppendSymbols(pairrngbyteLocal.first, nLocalSymbols, pairrngbyteLocal.second);
+		AppendSymbols(*orngbyteSymbols, symtabcmd.nsyms, *orngbyteStrings);
+		symtabcmd.symoff = AppendLinkedit(tc::range_as_blob(vecnlist));
+		symtabcmd.nsyms = tc::explicit_cast<std::uint32_t>(tc::size(vecnlist));
+
+		if(oibDysymtab) {
+			auto dysymtabcmd = *Read<dysymtab_command>(vecbyteHeader, *oibDysymtab);
+			auto const orngbyteIndirect = LinkeditData(dysymtabcmd.indirectsymoff, std::uint64_t(dysymtabcmd.nindirectsyms) * sizeof(std::uint32_t));
+			if(!orngbyteIndirect) return std::nullopt;
+			// The image's own symbols keep their order behind the local symbols, so their indices move by nLocalSymbols
+			auto const vecnIndirect = tc::make_vector(tc::transform(tc::iota(std::uint32_t(0), dysymtabcmd.nindirectsyms), [&](std::uint32_t iIndirect) noexcept {
+				auto const nIndirect = *Read<std::uint32_t>(*orngbyteIndirect, std::uint64_t(iIndirect) * sizeof(std::uint32_t));
+				return 0 == (nIndirect & (c_nIndirectSymbolLocal | c_nIndirectSymbolAbs)) ? nIndirect + nLocalSymbols : nIndirect;
+			}));
+			dysymtabcmd.indirectsymoff = 0 == dysymtabcmd.nindirectsyms ? 0 : AppendLinkedit(tc::range_as_blob(vecnIndirect));
+			if(0 == dysymtabcmd.nlocalsym || 0 == dysymtabcmd.ilocalsym) {
+				dysymtabcmd.ilocalsym = 0;
+				dysymtabcmd.nlocalsym += nLocalSymbols;
+			} else {
+				dysymtabcmd.ilocalsym += nLocalSymbols;
+			}
+			dysymtabcmd.iextdefsym += nLocalSymbols;
+			dysymtabcmd.iundefsym += nLocalSymbols;
+			dysymtabcmd.tocoff = dysymtabcmd.ntoc = 0;
+			dysymtabcmd.modtaboff = dysymtabcmd.nmodtab = 0;
+			dysymtabcmd.extrefsymoff = dysymtabcmd.nextrefsyms = 0;
+			dysymtabcmd.extreloff = dysymtabcmd.nextrel = 0;
+			dysymtabcmd.locreloff = dysymtabcmd.nlocrel = 0;
+			Write(vecbyteHeader, *oibDysymtab, dysymtabcmd);
+		}
+
+		symtabcmd.stroff = AppendLinkedit(vecbyteStrings);
+		symtabcmd.strsize = tc::explicit_cast<std::uint32_t>(tc::size(vecbyteStrings));
+		Write(vecbyteHeader, *oibSymtab, symtabcmd);
+	}
+
+	segcmdLinkedit.fileoff = ibLinkedit;
+	segcmdLinkedit.filesize = tc::size(vecbyteOut) - ibLinkedit;
+	segcmdLinkedit.vmsize = RoundUp(segcmdLinkedit.filesize, cbPage);
+	Write(vecbyteHeader, *oibLinkedit, segcmdLinkedit);
+
+	auto header = *oheader;
+	header.flags &= ~c_nFlagDylibInCache;
+	Write(vecbyteHeader, 0, header);
+
+	// __TEXT starts with the mach header
+	if(tc::size(vecbyteOut) < tc::size(vecbyteHeader)) {
+		return std::nullopt;
+	}
+	std::memcpy(tc::ptr_begin(vecbyteOut), tc::ptr_begin(vecbyteHeader), tc::size(vecbyteHeader));
+	return vecbyteOut;
+}
@@ -0,0 +1,59 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+#include "MachOFormat.h"
+
+// Read-only view of a memory-mapped dyld shared cache, e.g., /System/Library/dyld/dyld_shared_cache_x86_64h copied from a Mac.
+// Since macOS 12 the cache is split into a main cache file and sub cache files next to it (dyld_shared_cache_x86_64h.1,
+// dyld_shared_cache_x86_64h.01, ...). Images are addressed by the unslid address of their mach header.
+struct SDyldSharedCache final {
+	struct SImage final {
+		std::uint64_t m_pvHeader;
+		std::basic_string<char> m_strPath; // install name, e.g., /usr/lib/libobjc.A.dylib
+	};
+
+	// Opens the main cache file strPath and its sub caches. Returns std::nullopt if strPath is not a dyld shared cache.
+	static std::optional<SDyldSharedCache> Open(std::basic_string<char> const& strPath) THROW(tc::file_failure);
+
+	tc::vector<SImage> const& Images() const& noexcept {
+		return m_vecimage;
+	}
+
+	std::optional<std::array<std::uint8_t, 16>> ImageUuid(std::uint64_t pvHeader) const& noexcept {
+		return macho::Uuid(Memory(pvHeader), 0);
+	}
+
+	// Rebuilds a standalone dylib from the image at pvHeader, similar to dyld_shared_cache_util -extract. The segments are copied
+	// unchanged. The link edit segment only keeps the image's own symbols, strings, indirect symbols, function starts, data in code
+	// and exports trie; rebase and bind information is dropped because lldb does not need it to symbolicate. The cache keeps the
+	// local symbols of all images apart from their symbol tables, they are merged back in front of the image's symbols.
+	// Returns std::nullopt if the image is malformed.
+	std::optional<tc::vector<unsigned char>> ExtractImage(std::uint64_t pvHeader) const& noexcept;
+
+private:
+	struct SFile final {
+		SFileMapping m_filemapping;
+		tc::vector<macho::dyld_cache_mapping_info> m_vecmapping;
+	};
+	tc::vector<SFile> m_vecfile; // main cache first
+	tc::vector<SImage> m_vecimage;
+
+	// Local symbols are in the main cache file or, since macOS 12, in the .symbols file
+	std::optional<SFileMapping> m_ofilemappingSymbols;
+	std::uint64_t m_ibLocalSymbols = 0; // dyld_cache_local_symbols_info
+	std::uint64_t m_cbLocalSymbols = 0; // 0 if the cache has no local symbols
+	bool m_bLocalSymbolsEntries64 = false; // dyld_cache_local_symbols_entry_64 instead of dyld_cache_local_symbols_entry
+
+	// Bytes from pv to the end of the mapping containing pv, empty if pv is not mapped by any cache file
+	tc::ptr_range<unsigned char const> Memory(std::uint64_t pv) const& noexcept;
+
+	// nlist_64 entries of the local symbols of the image at pvHeader and the string pool they refer to, empty if there are none
+	std::pair<tc::ptr_range<unsigned char const>, tc::ptr_range<unsigned char const>> LocalSymbols(std::uint64_t pvHeader) const& noexcept;
+};
@@ -6,6 +6,7 @@
 // See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
 
 #include "tc/range.h"
+#include "SymbolCache.h"
 #include <lldb/API/LLDB.h>
 
 std::basic_string<char> UuidPath() noexcept;
@@ -22,4 +23,5 @@ public:
 	
 	lldb::SBDebugger m_debugger;
 	bool m_bIgnoreLoadFail = false;
+	SSymbolCache::SStatistics m_symbolcachestats; // how many binaries and symbol files had to be copied to open the dump
 };
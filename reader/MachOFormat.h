@@ -0,0 +1,313 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+
+#include <boost/endian/conversion.hpp>
+#include <cstring>
+
+// Mach-O and dyld shared cache file formats as far as the backend tools need them. The backend tools also run on Linux,
+// where <mach-o/loader.h> does not exist. The layouts follow <mach-o/loader.h>, <mach-o/nlist.h>, <mach-o/fat.h> and
+// dyld's dyld_cache_format.h. Everything is little endian except for the fat header.
+namespace macho {
+	constexpr std::uint32_t c_nMagic64 = 0xfeedfacf;
+	constexpr std::uint32_t c_nMagicFat = 0xcafebabe; // stored big endian
+	constexpr std::uint32_t c_nMagicFat64 = 0xcafebabf; // stored big endian
+
+	constexpr std::uint32_t c_nCpuTypeI386 = 0x7;
+	constexpr std::uint32_t c_nCpuTypeX86_64 = 0x01000007;
+	constexpr std::uint32_t c_nCpuTypeArm64 = 0x0100000c;
+	constexpr std::uint32_t c_nCpuSubtypeMask = 0x00ffffff; // the upper bits are capability flags
+	constexpr std::uint32_t c_nCpuSubtypeX86_64H = 8;
+	constexpr std::uint32_t c_nCpuSubtypeArm64E = 2;
+	constexpr std::uint32_t c_nFlagDylibInCache = 0x80000000;
+
+	constexpr std::uint32_t c_nLcReqDyld = 0x80000000;
+	constexpr std::uint32_t c_nLcSymtab = 0x2;
+	constexpr std::uint32_t c_nLcDysymtab = 0xb;
+	constexpr std::uint32_t c_nLcIdDylib = 0xd;
+	constexpr std::uint32_t c_nLcSegment64 = 0x19;
+	constexpr std::uint32_t c_nLcUuid = 0x1b;
+	constexpr std::uint32_t c_nLcCodeSignature = 0x1d;
+	constexpr std::uint32_t c_nLcSegmentSplitInfo = 0x1e;
+	constexpr std::uint32_t c_nLcDyldInfo = 0x22;
+	constexpr std::uint32_t c_nLcDyldInfoOnly = 0x22 | c_nLcReqDyld;
+	constexpr std::uint32_t c_nLcFunctionStarts = 0x26;
+	constexpr std::uint32_t c_nLcDataInCode = 0x29;
+	constexpr std::uint32_t c_nLcDyldExportsTrie = 0x33 | c_nLcReqDyld;
+	constexpr std::uint32_t c_nLcDyldChainedFixups = 0x34 | c_nLcReqDyld;
+
+	constexpr std::uint32_t c_nIndirectSymbolLocal = 0x80000000;
+	constexpr std::uint32_t c_nIndirectSymbolAbs = 0x40000000;
+
+	constexpr std::uint32_t c_nSectionTypeMask = 0xff;
+	constexpr std::uint32_t c_nSectionZerofill = 0x1;
+	constexpr std::uint32_t c_nSectionGbZerofill = 0xc;
+	constexpr std::uint32_t c_nSectionThreadLocalZerofill = 0x12;
+
+	struct mach_header_64 final {
+		std::uint32_t magic;
+		std::int32_t cputype;
+		std::int32_t cpusubtype;
+		std::uint32_t filetype;
+		std::uint32_t ncmds;
+		std::uint32_t sizeofcmds;
+		std::uint32_t flags;
+		std::uint32_t reserved;
+	};
+
+	struct load_command final {
+		std::uint32_t cmd;
+		std::uint32_t cmdsize;
+	};
+
+	struct segment_command_64 final {
+		std::uint32_t cmd;
+		std::uint32_t cmdsize;
+		char segname[16];
+		std::uint64_t vmaddr;
+		std::uint64_t vmsize;
+		std::uint64_t fileoff;
+		std::uint64_t filesize;
+		std::int32_t maxprot;
+		std::int32_t initprot;
+		std::uint32_t nsects;
+		std::uint32_t flags;
+	};
+
+	struct section_64 final {
+		char sectname[16];
+		char segname[16];
+		std::uint64_t addr;
+		std::uint64_t size;
+		std::uint32_t offset;
+		std::uint32_t align;
+		std::uint32_t reloff;
+		std::uint32_t nreloc;
+		std::uint32_t flags;
+		std::uint32_t reserved1;
+		std::uint32_t reserved2;
+		std::uint32_t reserved3;
+	};
+
+	struct uuid_command final {
+		std::uint32_t cmd;
+		std::uint32_t cmdsize;
+		std::uint8_t uuid[16];
+	};
+
+	struct dylib_command final {
+		std::uint32_t cmd;
+		std::uint32_t cmdsize;
+		std::uint32_t name_offset;
+		std::uint32_t timestamp;
+		std::uint32_t current_version;
+		std::uint32_t compatibility_version;
+	};
+
+	struct symtab_command final {
+		std::uint32_t cmd;
+		std::uint32_t cmdsize;
+		std::uint32_t symoff;
+		std::uint32_t nsyms;
+		std::uint32_t stroff;
+		std::uint32_t strsize;
+	};
+
+	struct dysymtab_command final {
+		std::uint32_t cmd;
+		std::uint32_t cmdsize;
+		std::uint32_t ilocalsym;
+		std::uint32_t nlocalsym;
+		std::uint32_t iextdefsym;
+		std::uint32_t nextdefsym;
+		std::uint32_t iundefsym;
+		std::uint32_t nundefsym;
+		std::uint32_t tocoff;
+		std::uint32_t ntoc;
+		std::uint32_t modtaboff;
+		std::uint32_t nmodtab;
+		std::uint32_t extrefsymoff;
+		std::uint32_t nextrefsyms;
+		std::uint32_t indirectsymoff;
+		std::uint32_t nindirectsyms;
+		std::uint32_t extreloff;
+		std::uint32_t nextrel;
+		std::uint32_t locreloff;
+		std::uint32_t nlocrel;
+	};
+
+	struct linkedit_data_command final {
+		std::uint32_t cmd;
+		std::uint32_t cmdsize;
+		std::uint32_t dataoff;
+		std::uint32_t datasize;
+	};
+
+	struct dyld_info_command final {
+		std::uint32_t cmd;
+		std::uint32_t cmdsize;
+		std::uint32_t rebase_off;
+		std::uint32_t rebase_size;
+		std::uint32_t bind_off;
+		std::uint32_t bind_size;
+		std::uint32_t weak_bind_off;
+		std::uint32_t weak_bind_size;
+		std::uint32_t lazy_bind_off;
+		std::uint32_t lazy_bind_size;
+		std::uint32_t export_off;
+		std::uint32_t export_size;
+	};
+
+	struct nlist_64 final {
+		std::uint32_t n_strx;
+		std::uint8_t n_type;
+		std::uint8_t n_sect;
+		std::uint16_t n_desc;
+		std::uint64_t n_value;
+	};
+
+	struct fat_header final { // big endian
+		std::uint32_t magic;
+		std::uint32_t nfat_arch;
+	};
+
+	struct fat_arch final { // big endian
+		std::int32_t cputype;
+		std::int32_t cpusubtype;
+		std::uint32_t offset;
+		std::uint32_t size;
+		std::uint32_t align;
+	};
+
+	struct fat_arch_64 final { // big endian
+		std::int32_t cputype;
+		std::int32_t cpusubtype;
+		std::uint64_t offset;
+		std::uint64_t size;
+		std::uint32_t align;
+		std::uint32_t reserved;
+	};
+
+	// Prefix of dyld_cache_header. The header grew with every macOS release, mappingOffset is the size of the header actually present.
+	struct dyld_cache_header final {
+		char magic[16]; // "dyld_v1  x86_64h", "dyld_v1   arm64e", ...
+		std::uint32_t mappingOffset;
+		std::uint32_t mappingCount;
+		std::uint32_t imagesOffsetOld;
+		std::uint32_t imagesCountOld;
+		std::uint64_t dyldBaseAddress;
+		std::uint64_t codeSignatureOffset;
+		std::uint64_t codeSignatureSize;
+		std::uint64_t slideInfoOffsetUnused;
+		std::uint64_t slideInfoSizeUnused;
+		std::uint64_t localSymbolsOffset;
+		std::uint64_t localSymbolsSize;
+		std::uint8_t uuid[16];
+	};
+	// Since macOS 12, the local symbols are in a separate .symbols file whose uuid is in the header of the main cache
+	constexpr std::size_t c_nOffsetDyldCacheSymbolFileUuid = 0x190;
+	// Since macOS 12, the image array moved to the end of a larger header
+	constexpr std::size_t c_nOffsetDyldCacheImagesOffset = 0x1c0;
+	constexpr std::size_t c_nOffsetDyldCacheImagesCount = 0x1c4;
+
+	struct dyld_cache_mapping_info final {
+		std::uint64_t address;
+		std::uint64_t size;
+		std::uint64_t fileOffset;
+		std::uint32_t maxProt;
+		std::uint32_t initProt;
+	};
+
+	struct dyld_cache_image_info final {
+		std::uint64_t address;
+		std::uint64_t modTime;
+		std::uint64_t inode;
+		std::uint32_t pathFileOffset;
+		std::uint32_t pad;
+	};
+
+	// At localSymbolsOffset, all other offsets are relative to it
+	struct dyld_cache_local_symbols_info final {
+		std::uint32_t nlistOffset;
+		std::uint32_t nlistCount;
+		std::uint32_t stringsOffset;
+		std::uint32_t stringsSize;
+		std::uint32_t entriesOffset;
+		std::uint32_t entriesCount;
+	};
+
+	// Caches without symbolFileUUID, dylibOffset is the file offset of the mach header, which equals its offset from the first mapping
+	struct dyld_cache_local_symbols_entry final {
+		std::uint32_t dylibOffset;
+		std::uint32_t nlistStartIndex;
+		std::uint32_t nlistCount;
+	};
+
+	// Caches with symbolFileUUID, dylibOffset is the offset of the mach header from the address of the first mapping
+	struct dyld_cache_local_symbols_entry_64 final {
+		std::uint64_t dylibOffset;
+		std::uint32_t nlistStartIndex;
+		std::uint32_t nlistCount;
+	};
+
+	// Reads a T at ib without alignment requirements. Returns std::nullopt if it does not fit into rngbyte.
+	template<typename T>
+	std::optional<T> Read(tc::ptr_range<unsigned char const> rngbyte, std::uint64_t ib) noexcept {
+		static_assert(std::is_trivially_copyable<T>::value);
+		if(tc::size(rngbyte) < ib || tc::size(rngbyte) - ib < sizeof(T)) {
+			return std::nullopt;
+		}
+		T t;
+		std::memcpy(std::addressof(t), tc::ptr_begin(rngbyte) + ib, sizeof(T));
+		return t;
+	}
+
+	inline std::uint32_t FromBigEndian(std::uint32_t n) noexcept {
+		return boost::endian::big_to_native(n);
+	}
+
+	inline std::uint64_t FromBigEndian(std::uint64_t n) noexcept {
+		return boost::endian::big_to_native(n);
+	}
+
+	// Calls fn(load_command const&, std::uint64_t ibCommand) for each load command of the mach header at ibHeader.
+	// Returns false if the load commands do not fit into rngbyte.
+	template<typename Func>
+	bool ForEachLoadCommand(tc::ptr_range<unsigned char const> rngbyte, std::uint64_t ibHeader, Func fn) MAYTHROW {
+		auto const oheader = Read<mach_header_64>(rngbyte, ibHeader);
+		if(!oheader || c_nMagic64 != oheader->magic) {
+			return false;
+		}
+		auto ibCommand = ibHeader + sizeof(mach_header_64);
+		auto const ibEnd = ibCommand + oheader->sizeofcmds;
+		for(std::uint32_t iCommand = 0; iCommand < oheader->ncmds; ++iCommand) {
+			auto const oloadcmd = Read<load_command>(rngbyte, ibCommand);
+			if(!oloadcmd || oloadcmd->cmdsize < sizeof(load_command) || ibEnd < ibCommand + oloadcmd->cmdsize) {
+				return false;
+			}
+			fn(*oloadcmd, ibCommand); // MAYTHROW
+			ibCommand += oloadcmd->cmdsize;
+		}
+		return true;
+	}
+
+	inline std::optional<std::array<std::uint8_t, 16>> Uuid(tc::ptr_range<unsigned char const> rngbyte, std::uint64_t ibHeader) noexcept {
+		std::optional<std::array<std::uint8_t, 16>> oauuid;
+		ForEachLoadCommand(rngbyte, ibHeader, [&](load_command const& loadcmd, std::uint64_t ibCommand) noexcept {
+			if(c_nLcUuid == loadcmd.cmd) {
+				if(auto const ouuidcmd = Read<uuid_command>(rngbyte, ibCommand)) {
+					oauuid.emplace();
+					std::memcpy(oauuid->data(), ouuidcmd->uuid, 16);
+				}
+			}
+		});
+		return oauuid;
+	}
+}
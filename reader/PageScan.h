@@ -0,0 +1,96 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Scanning of dumped memory pages. Dumps can be several GB, so the inner loops are written to keep the memory bus busy.
+
+constexpr std::size_t c_cbScanPage = 4096;
+
+// pbPage must point to c_cbScanPage bytes, no alignment required
+inline bool IsZeroPage(unsigned char const* pbPage) noexcept {
+#if defined(__SSE2__)
+	// OR all 16 byte blocks together, four independent accumulators hide the load latency
+	__m128i anAcc[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+	for(std::size_t ib = 0; ib < c_cbScanPage; ib += 4 * sizeof(__m128i)) {
+		tc::for_each(tc::iota(0, 4), [&](int i) noexcept {
+			anAcc[i] = _mm_or_si128(anAcc[i], _mm_loadu_si128(reinterpret_cast<__m128i const*>(pbPage + ib) + i));
+		});
+	}
+	auto const nAcc = _mm_or_si128(_mm_or_si128(anAcc[0], anAcc[1]), _mm_or_si128(anAcc[2], anAcc[3]));
+	return 0xffff == _mm_movemask_epi8(_mm_cmpeq_epi8(nAcc, _mm_setzero_si128()));
+#else
+	std::uint64_t nAcc = 0;
+	for(std::size_t ib = 0; ib < c_cbScanPage; ib += sizeof(std::uint64_t)) {
+		std::uint64_t n;
+		std::memcpy(std::addressof(n), pbPage + ib, sizeof(n));
+		nAcc |= n;
+	}
+	return 0 == nAcc;
+#endif
+}
+
+// Byte value histogram. Add counts into four histograms in turn, so runs of equal bytes do not serialize on a single counter.
+struct SByteHistogram final {
+	void Add(tc::ptr_range<unsigned char const> rngbyte) & noexcept {
+		auto pb = tc::ptr_begin(rngbyte);
+		auto const pbEnd = tc::ptr_end(rngbyte);
+		for(; 4 <= pbEnd - pb; pb += 4) {
+			++m_aacb[0][pb[0]];
+			++m_aacb[1][pb[1]];
+			++m_aacb[2][pb[2]];
+			++m_aacb[3][pb[3]];
+		}
+		for(; pb != pbEnd; ++pb) {
+			++m_aacb[0][*pb];
+		}
+	}
+
+	void Add(SByteHistogram const& bytehistogram) & noexcept {
+		tc::for_each(tc::iota(0, 4), [&](int i) noexcept {
+			tc::for_each(tc::iota(0, 256), [&](int nByte) noexcept {
+				m_aacb[i][nByte] += bytehistogram.m_aacb[i][nByte];
+			});
+		});
+	}
+
+	std::uint64_t Count() const& noexcept {
+		std::uint64_t cb = 0;
+		tc::for_each(m_aacb, [&](auto const& acb) noexcept {
+			tc::for_each(acb, [&](std::uint64_t cbByte) noexcept { cb += cbByte; });
+		});
+		return cb;
+	}
+
+	// Shannon entropy in bits per byte: 0 for constant data, 8 for random or compressed data
+	double Entropy() const& noexcept {
+		auto const cb = Count();
+		if(0 == cb) {
+			return 0;
+		}
+		double dEntropy = 0;
+		tc::for_each(tc::iota(0, 256), [&](int nByte) noexcept {
+			if(auto const cbByte = m_aacb[0][nByte] + m_aacb[1][nByte] + m_aacb[2][nByte] + m_aacb[3][nByte]) {
+				auto const d = double(cbByte) / cb;
+				dEntropy -= d * std::log2(d);
+			}
+		});
+		return dEntropy;
+	}
+
+private:
+	std::array<std::array<std::uint64_t, 256>, 4> m_aacb = {};
+};
@@ -0,0 +1,236 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "PageStore.h"
+#include "MachOFormat.h"
+#include "PageScan.h"
+#include "Sha1.h"
+#include "tc/range.h"
+
+#include <charconv>
+#include <zlib.h>
+
+namespace {
+	static_assert(SPageStore::c_cbPage == c_cbScanPage);
+	constexpr std::uint64_t c_cbPackMax = std::uint64_t(1) << 30;
+	constexpr std::size_t c_cbPackFlush = 32 * 1024 * 1024; // new pages buffered before they are appended to the pack
+
+	SPageStore::SHash const c_hashZeroPage = {}; // zero pages are not stored
+
+	// File ranges of the core's segments with content, sorted and relative to the start of the dump file.
+	// Returns an empty vector if the dump has no valid core, then the whole dump is stored literally.
+	tc::vector<std::pair<std::uint64_t, std::uint64_t>> SegmentFileRanges(tc::ptr_range<unsigned char const> rngbyteDump) noexcept {
+		tc::vector<std::pair<std::uint64_t, std::uint64_t>> vecpairibcb;
+		auto const ibCore = tc::size(tc::take(rngbyteDump, tc::search<tc::return_border_after>(rngbyteDump, tc::range_as_blob("</root>"))));
+		auto const rngbyteCore = tc::drop_first(rngbyteDump, ibCore);
+		if(!macho::ForEachLoadCommand(rngbyteCore, 0, [&](macho::load_command const& loadcmd, std::uint64_t ibCommand) noexcept {
+			if(macho::c_nLcSegment64 == loadcmd.cmd) {
+				if(auto const osegcmd = macho::Read<macho::segment_command_64>(rngbyteCore, ibCommand)) {
+					if(0 != osegcmd->filesize && osegcmd->fileoff <= tc::size(rngbyteCore) && osegcmd->filesize <= tc::size(rngbyteCore) - osegcmd->fileoff) {
+						tc::cont_emplace_back(vecpairibcb, ibCore + osegcmd->fileoff, osegcmd->filesize);
+					}
+				}
+			}
+		})) {
+			return {};
+		}
+		tc::sort_inplace(vecpairibcb);
+		// MiniDumpWriteDump never writes overlapping segments, but do not rely on it
+		for(std::size_t i = 1; i < tc::size(vecpairibcb); ++i) {
+			if(vecpairibcb[i].first < vecpairibcb[i-1].first + vecpairibcb[i-1].second) {
+				return {};
+			}
+		}
+		return vecpairibcb;
+	}
+
+	template<typename T>
+	void AppendPod(tc::vector<unsigned char>& vecbyte, T const& t) noexcept {
+		tc::append(vecbyte, tc::as_blob(t));
+	}
+}
+
+SPageStore::SPageStore(std::basic_string<char> strFolder, bool bWriter) THROW(tc::file_failure)
+	: m_strFolder(tc_move(strFolder))
+{
+	NOEXCEPT(boost::filesystem::create_directories(tc::make_str(m_strFolder, "/packs")));
+
+	auto const strIndex = tc::make_str(m_strFolder, "/index");
+	std::size_t cRecords = 0;
+	if(boost::filesystem::exists(strIndex)) {
+		SFileMapping filemappingIndex(tc::as_c_str(strIndex)); // THROW(tc::file_failure)
+		tc::ptr_range<unsigned char const> rngbyteIndex = filemappingIndex;
+		// The last record is incomplete if the writer was killed while appending to the index, its page is added again
+		cRecords = tc::size(rngbyteIndex) / sizeof(SIndexRecord);
+		m_maphashlocation.reserve(cRecords);
+		tc::for_each(tc::iota(std::size_t(0), cRecords), [&](std::size_t iRecord) noexcept {
+			SIndexRecord indexrecord;
+			std::memcpy(std::addressof(indexrecord), tc::ptr_begin(rngbyteIndex) + iRecord * sizeof(SIndexRecord), sizeof(SIndexRecord));
+			m_maphashlocation.emplace(indexrecord.m_hash, SLocation{indexrecord.m_iPack, indexrecord.m_ib, indexrecord.m_cb});
+			m_iPackCurrent = std::max(m_iPackCurrent, indexrecord.m_iPack);
+		});
+	}
+
+	if(bWriter) {
+		// Records are appended to the index in one piece, so drop the incomplete record before appending new ones behind it
+		boost::system::error_code ec;
+		if(boost::filesystem::exists(strIndex, ec)) {
+			boost::filesystem::resize_file(strIndex, cRecords * sizeof(SIndexRecord), ec);
+			if(ec) {
+				TRACE("Could not truncate ", strIndex, ": ", ec.message());
+				throw tc::file_failure();
+			}
+		}
+		// The writer may have been killed after starting a new pack and before indexing any of its pages. Keep appending
+		// to the last pack file. Its pages without index records are never referenced.
+		for(boost::filesystem::directory_iterator it(tc::make_str(m_strFolder, "/packs"), ec), itEnd; !ec && itEnd != it; it.increment(ec)) {
+			auto const strFilename = it->path().filename().string();
+			std::uint32_t iPack;
+			if(auto const result = std::from_chars(tc::ptr_begin(strFilename), tc::ptr_end(strFilename), iPack, 16);
+				std::errc() == result.ec && 0 == std::strcmp(result.ptr, ".pack")
+			) {
+				m_iPackCurrent = std::max(m_iPackCurrent, iPack);
+			}
+		}
+		if(ec) {
+			TRACE("Could not list the packs in ", m_strFolder, ": ", ec.message());
+			throw tc::file_failure();
+		}
+		if(boost::filesystem::exists(PackPath(m_iPackCurrent), ec)) {
+			m_cbPackCurrent = boost::filesystem::file_size(PackPath(m_iPackCurrent), ec);
+			if(ec) {
+				TRACE("Could not get the size of ", PackPath(m_iPackCurrent), ": ", ec.message());
+				throw tc::file_failure();
+			}
+		}
+	}
+	m_vecofilemappingPack.resize(m_iPackCurrent + 1);
+}
+
+std::basic_string<char> SPageStore::PackPath(std::uint32_t iPack) const& noexcept {
+	return tc::make_str(m_strFolder, "/packs/", tc::as_padded_lc_hex(iPack), ".pack");
+}
+
+tc::vector<unsigned char> SPageStore::Archive(tc::ptr_range<unsigned char const> rngbyteDump, SArchiveStatistics& archivestats) & THROW(tc::file_failure) {
+	archivestats.m_cbDump += tc::size(rngbyteDump);
+
+	tc::vector<unsigned char> vecbyteManifest;
+	tc::append(vecbyteManifest, tc::range_as_blob(tc::as_c_str(c_szManifestMagic)));
+
+	// New pages and their index records are buffered and appended to the pack and the index every c_cbPackFlush bytes
+	// and at the end of the dump. The index is written after the pack, so an index record never refers to a page that is not in the pack.
+	tc::vector<unsigned char> vecbytePack;
+	tc::vector<SIndexRecord> vecindexrecord;
+	auto FlushPack = [&]() THROW(tc::file_failure) {
+		if(!tc::empty(vecbytePack)) {
+			tc::append(tc::appendfile(tc::as_c_str(PackPath(m_iPackCurrent))), vecbytePack); // THROW(tc::file_failure)
+			m_cbPackCurrent += tc::size(vecbytePack);
+			tc::append(tc::appendfile(tc::as_c_str(tc::make_str(m_strFolder, "/index"))), tc::range_as_blob(vecindexrecord)); // THROW(tc::file_failure)
+			tc::cont_clear(vecbytePack);
+			tc::cont_clear(vecindexrecord);
+		}
+	};
+
+	std::array<unsigned char, c_cbPage> abyteCompressed; // compress2 fails if the page does not get smaller
+	auto AddPage = [&](tc::ptr_range<unsigned char const> rngbytePage) THROW(tc::file_failure) {
+		std::array<unsigned char, c_cbPage> abytePage = {}; // the last page of a segment may be partial, pad it with zeros
+		std::memcpy(abytePage.data(), tc::ptr_begin(rngbytePage), tc::size(rngbytePage));
+
+		if(IsZeroPage(abytePage.data())) {
+			archivestats.m_cbZeroPages += tc::size(rngbytePage);
+			tc::append(vecbyteManifest, c_hashZeroPage);
+			return;
+		}
+
+		auto const hash = Sha1(abytePage);
+		if(m_maphashlocation.count(hash)) {
+			archivestats.m_cbDuplicatePages += tc::size(rngbytePage);
+		} else {
+			if(c_cbPackMax <= m_cbPackCurrent + tc::size(vecbytePack)) {
+				FlushPack(); // THROW(tc::file_failure)
+				++m_iPackCurrent;
+				m_cbPackCurrent = 0;
+				m_vecofilemappingPack.resize(m_iPackCurrent + 1);
+			}
+			// Pages that do not get smaller, e.g., pages of compressed images, are stored uncompressed
+			uLongf cbCompressed = tc::size(abyteCompressed);
+			auto const rngbyteStored = Z_OK == compress2(abyteCompressed.data(), std::addressof(cbCompressed), abytePage.data(), c_cbPage, Z_BEST_SPEED) && cbCompressed < c_cbPage
+				? tc::ptr_range<unsigned char const>(tc::counted(abyteCompressed.data(), cbCompressed))
+				: tc::ptr_range<unsigned char const>(abytePage);
+			SLocation const location{m_iPackCurrent, m_cbPackCurrent + tc::size(vecbytePack), tc::size(rngbyteStored)};
+			tc::append(vecbytePack, rngbyteStored);
+			tc::cont_emplace_back(vecindexrecord, SIndexRecord{hash, location.m_iPack, location.m_ib, location.m_cb});
+			m_maphashlocation.emplace(hash, location);
+			archivestats.m_cbNewPages += tc::size(rngbytePage);
+			archivestats.m_cbNewPagesStored += tc::size(rngbyteStored);
+			if(c_cbPackFlush <= tc::size(vecbytePack)) {
+				FlushPack(); // THROW(tc::file_failure)
+			}
+		}
+		tc::append(vecbyteManifest, hash);
+	};
+
+	std::uint64_t ibLiteral = 0;
+	auto AddExtent = [&](std::uint64_t ibPages, std::uint64_t cbPages) THROW(tc::file_failure) {
+		AppendPod(vecbyteManifest, ibPages - ibLiteral);
+		tc::append(vecbyteManifest, tc::take_first(tc::drop_first(rngbyteDump, ibLiteral), ibPages - ibLiteral));
+		archivestats.m_cbLiteral += ibPages - ibLiteral;
+
+		AppendPod(vecbyteManifest, cbPages);
+		for(std::uint64_t ib = 0; ib < cbPages; ib += c_cbPage) {
+			AddPage(tc::take_first(tc::drop_first(rngbyteDump, ibPages + ib), std::min<std::uint64_t>(c_cbPage, cbPages - ib))); // THROW(tc::file_failure)
+		}
+		ibLiteral = ibPages + cbPages;
+	};
+
+	tc::for_each(SegmentFileRanges(rngbyteDump), [&](auto const& pairibcb) THROW(tc::file_failure) {
+		AddExtent(pairibcb.first, pairibcb.second); // THROW(tc::file_failure)
+	});
+	AddExtent(tc::size(rngbyteDump), 0); // THROW(tc::file_failure)
+	FlushPack(); // THROW(tc::file_failure)
+	return vecbyteManifest;
+}
+
+tc::ptr_range<unsigned char const> SPageStore::Page(SHash const& hash) & THROW(tc::file_failure, ExLoadFail) {
+	static std::array<unsigned char, c_cbPage> const c_abyteZeroPage = {};
+	if(c_hashZeroPage == hash) {
+		return c_abyteZeroPage;
+	}
+
+	auto const it = m_maphashlocation.find(hash);
+	if(tc::end(m_maphashlocation) == it) {
+		TRACE("Page missing in page store ", m_strFolder);
+		throw ExLoadFail();
+	}
+	auto const location = it->second;
+	if(c_cbPage < location.m_cb) {
+		TRACE("Malformed index record in page store ", m_strFolder);
+		throw ExLoadFail();
+	}
+	if(tc::size(m_vecofilemappingPack) <= location.m_iPack) {
+		m_vecofilemappingPack.resize(location.m_iPack + 1);
+	}
+	auto& ofilemapping = m_vecofilemappingPack[location.m_iPack];
+	// The current pack grows while we archive, map it again if the page has been appended since we mapped it
+	if(!ofilemapping || tc::size(tc::ptr_range<unsigned char const>(*ofilemapping)) < location.m_ib + location.m_cb) {
+		ofilemapping.emplace(tc::as_c_str(PackPath(location.m_iPack))); // THROW(tc::file_failure)
+	}
+	tc::ptr_range<unsigned char const> rngbytePack = *ofilemapping;
+	if(tc::size(rngbytePack) < location.m_ib + location.m_cb) {
+		throw ExLoadFail();
+	}
+	auto const rngbyteStored = tc::counted(tc::ptr_begin(rngbytePack) + location.m_ib, location.m_cb);
+	if(c_cbPage == location.m_cb) {
+		return rngbyteStored;
+	}
+	uLongf cbPage = c_cbPage;
+	if(Z_OK != uncompress(m_abytePage.data(), std::addressof(cbPage), tc::ptr_begin(rngbyteStored), location.m_cb) || c_cbPage != cbPage) {
+		TRACE("Corrupt page in page store ", m_strFolder);
+		throw ExLoadFail();
+	}
+	return m_abytePage;
+}
@@ -0,0 +1,131 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+
+#include <array>
+#include <unordered_map>
+
+// Content-addressed archive of dump files. Dumps from the same build share most of their mapped pages, so each dump
+// is stored as a small manifest plus the pages no earlier dump contained.
+//
+// A dump file (the unzipped minidump.dmp) is the XML metadata followed by the core file, see MiniDumpWriteDump. The file
+// ranges of the core's LC_SEGMENT_64 commands are split into c_cbPage sized pages that are stored once in pack files,
+// indexed by the SHA-1 of the uncompressed page. Pages are deflated with zlib unless that does not make them smaller.
+// Zero pages are not stored at all. Everything else (metadata, mach header, load commands) is kept literally in the manifest.
+//
+// Layout below the store folder:
+//	packs/NNNNNNNN.pack	concatenated pages
+//	index				SIndexRecord for each page in the packs, appended when pages are added
+//
+// The store assumes a single writer. Readers may run concurrently with the writer. Only a writer repairs what a killed
+// writer left behind, so readers never modify the store.
+struct SPageStore final {
+	static constexpr std::size_t c_cbPage = 4096;
+	using SHash = std::array<unsigned char, 20>; // SHA-1, see Sha1.h
+
+	SPageStore(std::basic_string<char> strFolder, bool bWriter) THROW(tc::file_failure);
+
+	struct SArchiveStatistics final {
+		std::uint64_t m_cbDump = 0;
+		std::uint64_t m_cbLiteral = 0;
+		std::uint64_t m_cbZeroPages = 0;
+		std::uint64_t m_cbDuplicatePages = 0;
+		std::uint64_t m_cbNewPages = 0;
+		std::uint64_t m_cbNewPagesStored = 0; // m_cbNewPages after compression
+	};
+
+	// Adds the pages of rngbyteDump to the store and returns the manifest that rebuilds rngbyteDump
+	tc::vector<unsigned char> Archive(tc::ptr_range<unsigned char const> rngbyteDump, SArchiveStatistics& archivestats) & THROW(tc::file_failure);
+
+	// Rebuilds the dump described by rngbyteManifest and passes it in pieces to fnSink(tc::ptr_range<unsigned char const>)
+	template<typename Sink>
+	void Restore(tc::ptr_range<unsigned char const> rngbyteManifest, Sink fnSink) & THROW(tc::file_failure, ExLoadFail) {
+		ForEachManifestExtent(rngbyteManifest, [&](tc::ptr_range<unsigned char const> rngbyteLiteral, tc::ptr_range<SHash const> rnghash, std::uint64_t cbPages) THROW(tc::file_failure, ExLoadFail) {
+			if(!tc::empty(rngbyteLiteral)) {
+				fnSink(rngbyteLiteral); // MAYTHROW
+			}
+			tc::for_each(rnghash, [&](SHash const& hash) THROW(tc::file_failure, ExLoadFail) {
+				auto const cb = std::min<std::uint64_t>(cbPages, c_cbPage);
+				cbPages -= cb;
+				fnSink(tc::take_first(Page(hash), cb)); // THROW(tc::file_failure, ExLoadFail) MAYTHROW
+			});
+		}); // THROW(ExLoadFail)
+	}
+
+private:
+	struct SLocation final {
+		std::uint32_t m_iPack;
+		std::uint64_t m_ib;
+		std::uint64_t m_cb; // c_cbPage if the page is stored uncompressed
+	};
+
+	struct SIndexRecord final {
+		SHash m_hash;
+		std::uint32_t m_iPack;
+		std::uint64_t m_ib;
+		std::uint64_t m_cb;
+	};
+	static_assert(sizeof(SIndexRecord) == sizeof(SHash) + sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t)); // no padding in the index file
+
+	struct SHashHash final {
+		std::size_t operator()(SHash const& hash) const& noexcept {
+			std::size_t n;
+			std::memcpy(std::addressof(n), hash.data(), sizeof(n)); // SHA-1 is uniformly distributed
+			return n;
+		}
+	};
+
+	std::basic_string<char> m_strFolder;
+	std::unordered_map<SHash, SLocation, SHashHash> m_maphashlocation;
+	std::uint32_t m_iPackCurrent = 0;
+	std::uint64_t m_cbPackCurrent = 0;
+	tc::vector<std::optional<SFileMapping>> m_vecofilemappingPack; // mapped on first read
+	std::array<unsigned char, c_cbPage> m_abytePage; // the last page returned by Page if it was compressed
+
+	std::basic_string<char> PackPath(std::uint32_t iPack) const& noexcept;
+	// The returned range is valid until the next call
+	tc::ptr_range<unsigned char const> Page(SHash const& hash) & THROW(tc::file_failure, ExLoadFail);
+
+	// A manifest is c_szManifestMagic followed by extents. Each extent is a std::uint64_t byte count and that many literal bytes,
+	// followed by a std::uint64_t byte count and the hashes of the pages holding that many bytes.
+	static constexpr char c_szManifestMagic[] = "tcpgmf01";
+
+	// Calls fn(rngbyteLiteral, rnghash, cbPages) for each extent of the manifest
+	template<typename Func>
+	static void ForEachManifestExtent(tc::ptr_range<unsigned char const> rngbyteManifest, Func fn) THROW(ExLoadFail) {
+		auto ReadCount = [&]() THROW(ExLoadFail) {
+			std::uint64_t n;
+			if(tc::size(rngbyteManifest) < sizeof(n)) {
+				throw ExLoadFail();
+			}
+			std::memcpy(std::addressof(n), tc::ptr_begin(rngbyteManifest), sizeof(n));
+			tc::drop_first_inplace(rngbyteManifest, sizeof(n));
+			return n;
+		};
+		auto Take = [&](std::uint64_t cb) THROW(ExLoadFail) {
+			if(tc::size(rngbyteManifest) < cb) {
+				throw ExLoadFail();
+			}
+			auto const rngbyte = tc::take_first(rngbyteManifest, cb);
+			tc::drop_first_inplace(rngbyteManifest, cb);
+			return rngbyte;
+		};
+
+		if(!tc::equal(tc::as_typed_range<char>(Take(sizeof(c_szManifestMagic) - 1)), tc::as_c_str(c_szManifestMagic))) { // THROW(ExLoadFail)
+			throw ExLoadFail();
+		}
+		while(!tc::empty(rngbyteManifest)) {
+			auto const rngbyteLiteral = Take(ReadCount()); // THROW(ExLoadFail)
+			auto const cbPages = ReadCount(); // THROW(ExLoadFail)
+			auto const rngbyteHash = Take((cbPages + c_cbPage - 1) / c_cbPage * sizeof(SHash)); // THROW(ExLoadFail)
+			fn(rngbyteLiteral, tc::counted(reinterpret_cast<SHash const*>(tc::ptr_begin(rngbyteHash)), tc::size(rngbyteHash) / sizeof(SHash)), cbPages); // MAYTHROW
+		}
+	}
+};
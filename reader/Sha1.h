@@ -0,0 +1,30 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+
+#include <array>
+#include <boost/uuid/detail/sha1.hpp>
+
+// SHA-1 of rngbyte in the usual byte order, i.e., the order of sha1sum's output
+inline std::array<unsigned char, 20> Sha1(tc::ptr_range<unsigned char const> rngbyte) noexcept {
+	boost::uuids::detail::sha1 sha1;
+	sha1.process_bytes(tc::ptr_begin(rngbyte), tc::size(rngbyte));
+	boost::uuids::detail::sha1::digest_type digest;
+	sha1.get_digest(digest);
+
+	std::array<unsigned char, 20> abyteHash;
+	tc::for_each(tc::iota(std::size_t(0), tc::size(digest)), [&](std::size_t i) noexcept {
+		abyteHash[4*i] = tc::explicit_cast<unsigned char>(digest[i] >> 24);
+		abyteHash[4*i+1] = tc::explicit_cast<unsigned char>(digest[i] >> 16);
+		abyteHash[4*i+2] = tc::explicit_cast<unsigned char>(digest[i] >> 8);
+		abyteHash[4*i+3] = tc::explicit_cast<unsigned char>(digest[i]);
+	});
+	return abyteHash;
+}
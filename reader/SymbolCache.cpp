@@ -0,0 +1,260 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "tc/range.h"
+
+#include "SymbolCache.h"
+#include "UuidIndex.h"
+
+#include <charconv>
+#include <copyfile.h>
+#include <spawn.h>
+
+namespace {
+	std::basic_string<char> SymbolCache() noexcept {
+		// FIXME: Path to local binary cache.
+		// The binaries stored on the server are cached locally. Even over fast Ethernet,
+		// opening a dump can take quite long otherwise. Binaries will be stored in subfolders
+		// describing their binary uuid
+		// ~/symbol_cache/000C/4E9F/E0D9/371D/B304/83BA37460724/library
+		return tc::make_str(VERIFY(::getenv("HOME")), "/symbol_cache/");
+	}
+
+	std::basic_string<char> SymbolsPath() noexcept {
+		// FIXME: Contains files describing your symbols. Files contain two lines.
+		// 1. Path to the actual symbol file
+		// 2. Path on c_szSourceServer where the source code to this build can be mapped
+		// ~/path_to_/program.app.dSYM/Contents/Resources/DWARF/program
+		// 201108_my_program_build
+		return tc::make_str(VERIFY(::getenv("HOME")), "/symbols/");
+	}
+
+	constexpr char c_szSourceServer[] = "http://sourceserver/"; // SVN repos can be mounted so lldb can display source code
+
+	// Size of a file or of all files in a folder, e.g., a .dSYM package
+	std::uint64_t FileOrFolderSize(std::basic_string<char> const& strPath) noexcept {
+		if(boost::filesystem::is_regular_file(strPath)) {
+			return boost::filesystem::file_size(strPath);
+		}
+		std::uint64_t cb = 0;
+		tc::for_each(tc::filesystem::recursive_file_range(strPath), [&](auto&& direntry) noexcept {
+			cb += boost::filesystem::file_size(direntry);
+		});
+		return cb;
+	}
+}
+
+SSymbolCache::SSymbolCache(std::basic_string<char> strUuidsPath) noexcept
+	: m_strUuidsPath(tc_move(strUuidsPath))
+	, m_strSymbolsPath(SymbolsPath())
+{
+	_ASSERT(boost::filesystem::is_directory(m_strUuidsPath));
+}
+
+// We cache the binaries and the symbol files which lets lldb memory-map them.
+// If the file is not yet in the cache, we first download the files to a temp file in the
+// same folder as the cache file and then rename it to the cached file name.
+// Several processes may attempt to cache the same file at the same time.
+std::basic_string<char> SSymbolCache::CacheFile(std::basic_string<char> strSource, std::basic_string<char> strPathCached) & noexcept {
+	if(boost::filesystem::exists(strPathCached)) {
+		++m_stats.m_nFilesCached;
+		return strPathCached;
+	} else if(boost::filesystem::exists(strSource)) { // may happen if the uuid-to-binary-index is out-of-date
+		NOEXCEPT(boost::filesystem::create_directories( tc::make_str(FilenameWithoutPath<tc::return_take>(strPathCached)) ));
+		auto const strPathTemp = tc::make_str(FilenameWithoutPath<tc::return_take>(strPathCached), tc::unique_name<SBase32CodeTable>());
+
+		// We call the command line cp command instead of ::copyfile because the latter copied files only partially when copying from
+		// a server share using the SMB v2 protocol. It seemed to work fine when using a share with SMB v3 but our current server
+		// cannot supply that.
+		//
+		// ERRNOIGNORE(
+		// 		copyfile(tc::as_c_str(strSource), tc::as_c_str(strPathTemp), nullptr, COPYFILE_DATA|COPYFILE_NOFOLLOW|COPYFILE_EXCL|COPYFILE_RECURSIVE), // COPYFILE_RECURSIVE because strSource may be a .dSYM directory
+		// 		tc::err::returned(0),
+		//		tc::err::returned_less_than(0, as_constexpr(tc::make_array(tc::aggregate_tag, EACCES, ENOENT)))
+		//	))
+		if(0==CreateAndWaitForProcess(
+			"/bin/cp",
+			tc::make_array<char const*>(
+				tc::aggregate_tag,
+				"-R",
+				tc::as_c_str(strSource),
+				tc::as_c_str(strPathTemp)
+			)
+		)) {
+			// Assert copying succeeds. Otherwise our cache is inconsistent.
+			auto const cbTemp = FileOrFolderSize(strPathTemp);
+			_ASSERTPRINT(FileOrFolderSize(strSource)==cbTemp, "Copy file failed: ", strSource, " does not have same size as ", strPathTemp);
+			++m_stats.m_nFilesCopied;
+			m_stats.m_cbCopied += cbTemp;
+
+			// renamex_np is a POSIX extension that returns EEXIST when the target file already exists
+			if(!ERRNOIGNORE(
+				renamex_np(tc::as_c_str(strPathTemp), tc::as_c_str(strPathCached), RENAME_EXCL),
+				tc::err::returned(0),
+				tc::err::returned(-1, EEXIST)
+			)) {
+				tc::filesystem::remove_all(tc::as_c_str(strPathTemp));
+			};
+			return strPathCached;
+		}
+		return strSource;
+	} else {
+		return std::basic_string<char>();
+	}
+}
+
+// Extracts the image at pvHeader from a dyld shared cache on the server into the folder strFolderCached of the local binary cache.
+// Like CacheFile, we write to a temp file first and rename it because several processes may extract the same image at the same time.
+// Returns the path of the extracted image or an empty string.
+std::basic_string<char> SSymbolCache::CacheDyldSharedCacheImage(std::basic_string<char> const& strDyldCache, std::uint64_t pvHeader, std::basic_string<char> const& strFolderCached) & noexcept {
+	auto it = m_mapstrodyldcache.find(strDyldCache);
+	if(tc::end(m_mapstrodyldcache) == it) {
+		std::optional<SDyldSharedCache> odyldcache;
+		try {
+			odyldcache = SDyldSharedCache::Open(strDyldCache); // THROW(tc::file_failure)
+		} catch(tc::file_failure const&) {
+			TRACE("Could not open dyld shared cache ", strDyldCache, "\n");
+		}
+		it = m_mapstrodyldcache.emplace(strDyldCache, tc_move(odyldcache)).first;
+	}
+	if(!it->second) {
+		return std::basic_string<char>();
+	}
+	auto const& dyldcache = *it->second;
+
+	auto const itimage = std::find_if(tc::begin(dyldcache.Images()), tc::end(dyldcache.Images()), [&](SDyldSharedCache::SImage const& image) noexcept {
+		return image.m_pvHeader == pvHeader;
+	});
+	if(tc::end(dyldcache.Images()) == itimage) {
+		TRACE("No image at ", tc::as_padded_lc_hex(pvHeader), " in dyld shared cache ", strDyldCache, "\n");
+		return std::basic_string<char>();
+	}
+
+	auto strPathCached = tc::make_str(strFolderCached, FilenameWithoutPath<tc::return_drop>(itimage->m_strPath));
+	if(boost::filesystem::exists(strPathCached)) {
+		++m_stats.m_nFilesCached;
+		return strPathCached;
+	}
+
+	auto const ovecbyteImage = dyldcache.ExtractImage(pvHeader);
+	if(!ovecbyteImage) {
+		TRACE("Could not extract ", itimage->m_strPath, " from dyld shared cache ", strDyldCache, "\n");
+		return std::basic_string<char>();
+	}
+
+	NOEXCEPT(boost::filesystem::create_directories(strFolderCached));
+	auto const strPathTemp = tc::make_str(strFolderCached, tc::unique_name<SBase32CodeTable>());
+	try {
+		tc::append(tc::appendfile(tc::as_c_str(strPathTemp), tc::create_new_tag), *ovecbyteImage); // THROW(tc::file_failure)
+	} catch(tc::file_failure const&) {
+		tc::filesystem::remove_all(tc::as_c_str(strPathTemp));
+		return std::basic_string<char>();
+	}
+	++m_stats.m_nFilesCopied;
+	m_stats.m_cbCopied += tc::size(*ovecbyteImage);
+	if(!ERRNOIGNORE(
+		renamex_np(tc::as_c_str(strPathTemp), tc::as_c_str(strPathCached), RENAME_EXCL),
+		tc::err::returned(0),
+		tc::err::returned(-1, EEXIST)
+	)) {
+		tc::filesystem::remove_all(tc::as_c_str(strPathTemp));
+	}
+	return strPathCached;
+}
+
+std::pair<std::basic_string<char>, std::basic_string<char>> SSymbolCache::LookupBinaryAndSymbol(tc::ptr_range<char const> strUuid, bool bMountSource) & noexcept {
+	try {
+		// We use the same folder format for our uuid -> binary map that lldb would use for
+		// the uuid -> debug symbol map. See https://lldb.llvm.org/symbols.html
+		// uuids have the form C4CBD2CF-39D5-3185-851E-85C7DD2F8C7F and the path to the uuid file will be
+		// C4CB/D2CF/39D5/3185/851E/85C7DD2F8C7F
+		_ASSERTEQUAL(tc::size(strUuid), 36);
+
+		auto AppendUuid = [&](auto const& str) noexcept {
+			return UuidIndexPath(str, strUuid);
+		};
+
+		// Lookup strUuid in our uuid-to-binary index. The file for strUuid contains
+		// a relative path to a binary or to an image in a dyld shared cache, see UuidIndex.h.
+		auto const strEntry = tc::make_str(
+			tc::as_typed_range<char>(SFileMapping(tc::as_c_str(tc::make_str(AppendUuid(m_strUuidsPath)))))
+		); // THROW(tc::file_failure)
+
+		// A cache image entry ends in # and the hex address of the image. Paths may contain # themselves, so the entry is
+		// a regular binary path unless the part after the last # is a valid address.
+		if(auto const itchImage = tc::find_last<tc::return_element_or_null>(strEntry, c_chDyldSharedCacheImage)) {
+			auto const strAddress = tc::make_str(tc::drop(strEntry, modified(itchImage, ++_)));
+			std::uint64_t pvHeader;
+			if(auto const result = std::from_chars(tc::ptr_begin(strAddress), tc::ptr_end(strAddress), pvHeader, 16); std::errc() == result.ec && tc::ptr_end(strAddress) == result.ptr) {
+				// System libraries have no separate symbol files
+				return std::make_pair(
+					CacheDyldSharedCacheImage(
+						tc::make_str(VERIFY(::getenv("HOME")), "/mnt/", tc::take(strEntry, itchImage)), // FIXME
+						pvHeader,
+						tc::make_str(AppendUuid(SymbolCache()), "/")
+					),
+					std::basic_string<char>()
+				);
+			}
+		}
+
+		// FIXME
+		auto strBinary = tc::make_str(
+			VERIFY(::getenv("HOME")),
+			"/mnt/",
+			strEntry
+		);
+
+		auto const strCacheFolder = tc::concat(AppendUuid(SymbolCache()), "/");
+		auto const strBinaryFilename = FilenameWithoutPath<tc::return_drop>(strBinary);
+
+		std::basic_string<char> strSymbols;
+		try {
+			auto const strContents = tc::make_str(
+				tc::as_typed_range<char>(SFileMapping(tc::as_c_str(tc::make_str(m_strSymbolsPath, strUuid))))
+			); // THROW(tc::file_failure)
+
+			auto const strPath = tc::find_first<tc::return_take_before>(strContents, '\n');
+			_ASSERTEQUAL(tc::front(strPath), '~');
+
+			if(bMountSource) {
+				CreateAndWaitForProcess(
+					"/usr/bin/osascript",
+					tc::make_array<char const*>(tc::aggregate_tag, "-s", "o", "-e", tc::make_c_str("mount volume \"", , c_szSourceServer, tc::drop(strContents, modified(tc::end(strPath), ++_)), "\""))
+				);
+			}
+
+			// We cache the symbol file at the location where lldb will look for it. The API does not allow
+			// us to set the symbol file for the executable explicitly.
+
+			// FIXME
+			// Drop /Contents/Resources/DWARF/lib to get path of lib.dSYM symbol package
+			auto const strDSymPath =
+				tc::drop_last(FilenameWithoutPath<tc::return_take>(
+					tc::drop_last(FilenameWithoutPath<tc::return_take>(
+						tc::drop_last(FilenameWithoutPath<tc::return_take>(
+							tc::drop_last(FilenameWithoutPath<tc::return_take>(
+								strPath
+							))
+						))
+					))
+				));
+			strSymbols = CacheFile(
+				tc::make_str(VERIFY(::getenv("HOME")), tc::drop_first(strDSymPath)), // copy the entire .dSYM folder recursively
+				tc::make_str(strCacheFolder, strBinaryFilename, ".dSYM")
+			);
+
+			// FIXME
+			// Append Contents/Resources/DWARF/lib filename again and return it to lldb
+			tc::append(strSymbols, tc::drop(strPath, tc::end(strDSymPath)));
+		} catch(tc::file_failure const&) {
+		}
+		return std::make_pair(CacheFile(tc_move(strBinary), tc::make_str(strCacheFolder, strBinaryFilename)), tc_move(strSymbols));
+	} catch(tc::file_failure const&) {
+	}
+	return std::make_pair(std::basic_string<char>(), std::basic_string<char>());
+}
@@ -0,0 +1,40 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+#include "DyldSharedCache.h"
+
+#include <map>
+
+// Looks up binaries and debug symbols on the server by uuid and caches them locally. Several processes, e.g., opendump and
+// prewarmsymbols, may cache the same file at the same time. An SSymbolCache object must only be used by one thread.
+struct SSymbolCache final {
+	// strUuidsPath is the uuid index created by scripts/RebuildUuidDatabase.py
+	explicit SSymbolCache(std::basic_string<char> strUuidsPath) noexcept;
+
+	// Returns the paths of the cached binary and symbol file of the module strUuid, copying them from the server if they are
+	// not cached yet. The paths are empty if the module is unknown. strUuid has the form C4CBD2CF-39D5-3185-851E-85C7DD2F8C7F.
+	// If bMountSource, the source code of the module is mounted from c_szSourceServer.
+	std::pair<std::basic_string<char>, std::basic_string<char>> LookupBinaryAndSymbol(tc::ptr_range<char const> strUuid, bool bMountSource) & noexcept;
+
+	struct SStatistics final {
+		std::size_t m_nFilesCached = 0; // found in the local cache
+		std::size_t m_nFilesCopied = 0; // copied from the server or extracted from a dyld shared cache
+		std::uint64_t m_cbCopied = 0;
+	};
+	SStatistics m_stats;
+
+private:
+	std::basic_string<char> m_strUuidsPath;
+	std::basic_string<char> m_strSymbolsPath;
+	std::map<std::basic_string<char>, std::optional<SDyldSharedCache>> m_mapstrodyldcache; // opened on first use, see CacheDyldSharedCacheImage
+
+	std::basic_string<char> CacheFile(std::basic_string<char> strSource, std::basic_string<char> strPathCached) & noexcept;
+	std::basic_string<char> CacheDyldSharedCacheImage(std::basic_string<char> const& strDyldCache, std::uint64_t pvHeader, std::basic_string<char> const& strFolderCached) & noexcept;
+};
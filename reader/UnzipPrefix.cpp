@@ -0,0 +1,169 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "UnzipPrefix.h"
+
+#include <array>
+#include <boost/endian/conversion.hpp>
+#include <zlib.h>
+
+namespace {
+	// See section 4.3.7 of the PKWARE .ZIP File Format Specification
+	constexpr std::uint32_t c_nZipLocalFileHeaderSignature = 0x04034b50;
+	constexpr std::size_t c_cbZipLocalFileHeader = 30;
+	constexpr std::uint16_t c_nZipFlagDataDescriptor = 0x8; // sizes follow the data instead of being in the local file header
+	constexpr std::uint16_t c_nZipMethodStored = 0;
+	constexpr std::uint16_t c_nZipMethodDeflated = 8;
+
+	constexpr std::size_t c_cbInflateChunk = 64 * 1024;
+
+	template<typename T>
+	T ReadLittleEndian(tc::ptr_range<unsigned char const> rngbyte, std::uint64_t ib) THROW(ExLoadFail) {
+		if(tc::size(rngbyte) < ib || tc::size(rngbyte) - ib < sizeof(T)) {
+			throw ExLoadFail();
+		}
+		T t;
+		std::memcpy(std::addressof(t), tc::ptr_begin(rngbyte) + ib, sizeof(T));
+		return boost::endian::little_to_native(t);
+	}
+
+	// Offset of the end of rngbyteEnd in rngbyte, starting the search at ibSearch
+	std::optional<std::size_t> FindEnd(tc::ptr_range<unsigned char const> rngbyte, std::size_t ibSearch, tc::ptr_range<unsigned char const> rngbyteEnd) noexcept {
+		auto const itEnd = std::search(tc::ptr_begin(rngbyte) + ibSearch, tc::ptr_end(rngbyte), tc::ptr_begin(rngbyteEnd), tc::ptr_end(rngbyteEnd));
+		if(tc::ptr_end(rngbyte) == itEnd) {
+			return std::nullopt;
+		}
+		return itEnd - tc::ptr_begin(rngbyte) + tc::size(rngbyteEnd);
+	}
+
+	tc::vector<unsigned char> InflatePrefix(tc::ptr_range<unsigned char const> rngbyteDeflated, tc::ptr_range<unsigned char const> rngbyteEnd) THROW(ExLoadFail) {
+		z_stream zstream = {};
+		if(Z_OK != inflateInit2(&zstream, -MAX_WBITS)) { // raw deflate data without zlib header
+			throw ExLoadFail();
+		}
+		scope_exit(inflateEnd(&zstream));
+
+		tc::vector<unsigned char> vecbyte;
+		for(;;) {
+			if(0 == zstream.avail_in) {
+				auto const cbIn = std::min<std::size_t>(tc::size(rngbyteDeflated), std::numeric_limits<uInt>::max());
+				zstream.next_in = const_cast<Bytef*>(tc::ptr_begin(rngbyteDeflated));
+				zstream.avail_in = tc::explicit_cast<uInt>(cbIn);
+				tc::drop_first_inplace(rngbyteDeflated, cbIn);
+			}
+
+			auto const cbBefore = tc::size(vecbyte);
+			vecbyte.resize(cbBefore + c_cbInflateChunk);
+			zstream.next_out = vecbyte.data() + cbBefore;
+			zstream.avail_out = c_cbInflateChunk;
+			auto const nResult = inflate(&zstream, Z_NO_FLUSH);
+			vecbyte.resize(cbBefore + c_cbInflateChunk - zstream.avail_out);
+
+			// rngbyteEnd may straddle two chunks
+			if(auto const ocb = FindEnd(tc::as_pointers(vecbyte), cbBefore - std::min(cbBefore, tc::size(rngbyteEnd) - 1), rngbyteEnd)) {
+				vecbyte.resize(*ocb);
+				return vecbyte;
+			}
+			if(Z_OK != nResult && Z_BUF_ERROR != nResult) { // Z_STREAM_END or corrupt data
+				throw ExLoadFail();
+			}
+			if(Z_BUF_ERROR == nResult && 0 == zstream.avail_in && tc::empty(rngbyteDeflated)) { // truncated archive
+				throw ExLoadFail();
+			}
+		}
+	}
+
+	// Compression method and compressed data of the file szName in the zip archive rngbyteZip
+	std::pair<std::uint16_t, tc::ptr_range<unsigned char const>> FindZipEntry(tc::ptr_range<unsigned char const> rngbyteZip, char const* szName) THROW(ExLoadFail) {
+		std::uint64_t ibHeader = 0;
+		while(c_nZipLocalFileHeaderSignature == ReadLittleEndian<std::uint32_t>(rngbyteZip, ibHeader)) { // THROW(ExLoadFail)
+			auto const nFlags = ReadLittleEndian<std::uint16_t>(rngbyteZip, ibHeader + 6); // THROW(ExLoadFail)
+			auto const nMethod = ReadLittleEndian<std::uint16_t>(rngbyteZip, ibHeader + 8); // THROW(ExLoadFail)
+			auto const cbCompressed = ReadLittleEndian<std::uint32_t>(rngbyteZip, ibHeader + 18); // THROW(ExLoadFail)
+			auto const cchName = ReadLittleEndian<std::uint16_t>(rngbyteZip, ibHeader + 26); // THROW(ExLoadFail)
+			auto const cbExtra = ReadLittleEndian<std::uint16_t>(rngbyteZip, ibHeader + 28); // THROW(ExLoadFail)
+			auto const ibData = ibHeader + c_cbZipLocalFileHeader + cchName + cbExtra;
+			if(tc::size(rngbyteZip) < ibData) {
+				throw ExLoadFail();
+			}
+
+			auto const strName = tc::as_typed_range<char>(tc::take_first(tc::drop_first(rngbyteZip, ibHeader + c_cbZipLocalFileHeader), cchName));
+			bool const bSizeKnown = !(nFlags & c_nZipFlagDataDescriptor) && 0xffffffff != cbCompressed; // 0xffffffff: size is in the zip64 extra field
+			if(tc::equal(strName, tc::as_c_str(szName))) {
+				auto const rngbyteData = tc::drop_first(rngbyteZip, ibData);
+				return std::make_pair(nMethod, bSizeKnown ? tc::take_first(rngbyteData, std::min<std::uint64_t>(cbCompressed, tc::size(rngbyteData))) : rngbyteData);
+			}
+			if(!bSizeKnown) {
+				throw ExLoadFail(); // cannot skip to the next local file header
+			}
+			ibHeader = ibData + cbCompressed;
+		}
+		throw ExLoadFail();
+	}
+}
+
+tc::vector<unsigned char> UnzipPrefix(tc::ptr_range<unsigned char const> rngbyteZip, char const* szName, tc::ptr_range<unsigned char const> rngbyteEnd) THROW(ExLoadFail) {
+	_ASSERT(!tc::empty(rngbyteEnd));
+	auto const pairnrngbyte = FindZipEntry(rngbyteZip, szName); // THROW(ExLoadFail)
+	switch(pairnrngbyte.first) {
+	case c_nZipMethodStored:
+		if(auto const ocb = FindEnd(pairnrngbyte.second, 0, rngbyteEnd)) {
+			return tc::make_vector(tc::take_first(pairnrngbyte.second, *ocb));
+		}
+		throw ExLoadFail();
+	case c_nZipMethodDeflated:
+		return InflatePrefix(pairnrngbyte.second, rngbyteEnd); // THROW(ExLoadFail)
+	default:
+		throw ExLoadFail();
+	}
+}
+
+void UnzipToFile(tc::ptr_range<unsigned char const> rngbyteZip, char const* szName, char const* szFile) THROW(tc::file_failure, ExLoadFail) {
+	auto const pairnrngbyte = FindZipEntry(rngbyteZip, szName); // THROW(ExLoadFail)
+	auto file = tc::appendfile(szFile, tc::create_new_tag); // THROW(tc::file_failure)
+	switch(pairnrngbyte.first) {
+	case c_nZipMethodStored:
+		tc::append(file, pairnrngbyte.second); // THROW(tc::file_failure)
+		return;
+	case c_nZipMethodDeflated:
+		break;
+	default:
+		throw ExLoadFail();
+	}
+
+	auto rngbyteDeflated = pairnrngbyte.second;
+	z_stream zstream = {};
+	if(Z_OK != inflateInit2(&zstream, -MAX_WBITS)) { // raw deflate data without zlib header
+		throw ExLoadFail();
+	}
+	scope_exit(inflateEnd(&zstream));
+
+	std::array<unsigned char, c_cbInflateChunk> abyte;
+	for(;;) {
+		if(0 == zstream.avail_in) {
+			auto const cbIn = std::min<std::size_t>(tc::size(rngbyteDeflated), std::numeric_limits<uInt>::max());
+			zstream.next_in = const_cast<Bytef*>(tc::ptr_begin(rngbyteDeflated));
+			zstream.avail_in = tc::explicit_cast<uInt>(cbIn);
+			tc::drop_first_inplace(rngbyteDeflated, cbIn);
+		}
+
+		zstream.next_out = abyte.data();
+		zstream.avail_out = c_cbInflateChunk;
+		auto const nResult = inflate(&zstream, Z_NO_FLUSH);
+		tc::append(file, tc::counted(abyte.data(), c_cbInflateChunk - zstream.avail_out)); // THROW(tc::file_failure)
+
+		if(Z_STREAM_END == nResult) {
+			return;
+		}
+		if(Z_OK != nResult && Z_BUF_ERROR != nResult) { // corrupt data
+			throw ExLoadFail();
+		}
+		if(Z_BUF_ERROR == nResult && 0 == zstream.avail_in && tc::empty(rngbyteDeflated)) { // truncated archive
+			throw ExLoadFail();
+		}
+	}
+}
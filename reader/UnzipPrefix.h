@@ -0,0 +1,20 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+
+// Inflates the file szName in the zip archive rngbyteZip only up to and including the first occurrence of rngbyteEnd,
+// e.g., the XML metadata in front of the core file of minidump.dmp. Only the local file headers are read, so with a
+// memory-mapped archive only the pages holding the prefix are read from disk.
+// Throws ExLoadFail if the archive does not contain szName or szName does not contain rngbyteEnd.
+tc::vector<unsigned char> UnzipPrefix(tc::ptr_range<unsigned char const> rngbyteZip, char const* szName, tc::ptr_range<unsigned char const> rngbyteEnd) THROW(ExLoadFail);
+
+// Inflates the file szName in the zip archive rngbyteZip into the new file szFile in chunks, without holding it in memory.
+// Throws ExLoadFail if the archive does not contain szName or its data is corrupt.
+void UnzipToFile(tc::ptr_range<unsigned char const> rngbyteZip, char const* szName, char const* szFile) THROW(tc::file_failure, ExLoadFail);
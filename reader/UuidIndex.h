@@ -0,0 +1,64 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+
+#include <array>
+
+// The uuid index maps binary uuids to binaries on the server share. We use the same folder format for our uuid -> binary map
+// that lldb would use for the uuid -> debug symbol map. See https://lldb.llvm.org/symbols.html
+// uuids have the form C4CBD2CF-39D5-3185-851E-85C7DD2F8C7F and the path to the uuid file will be
+// C4CB/D2CF/39D5/3185/851E/85C7DD2F8C7F
+//
+// A uuid file contains the path of the binary relative to ~/mnt/. Images inside a dyld shared cache are stored as
+// <path of the cache relative to ~/mnt/>#<hex address of the image's mach header>, see SDyldSharedCache. Readers split
+// at the last #, because paths may contain # themselves.
+
+constexpr char c_chDyldSharedCacheImage = '#';
+
+inline std::basic_string<char> UuidString(std::array<std::uint8_t, 16> const& auuid) noexcept {
+	std::basic_string<char> str;
+	tc::for_each(tc::iota(std::size_t(0), tc::size(auuid)), [&](std::size_t ibyte) noexcept {
+		if(4==ibyte || 6==ibyte || 8==ibyte || 10==ibyte) {
+			tc::cont_emplace_back(str, '-');
+		}
+		tc::append(str, tc::as_padded_uc_hex(auuid[ibyte]));
+	});
+	return str;
+}
+
+template<typename Str, typename StrUuid>
+auto UuidIndexPath(Str const& strFolder, StrUuid const& strUuid) noexcept {
+	return tc::concat(
+		strFolder,
+		tc::take_first(strUuid, 4),
+		"/",
+		tc::drop_first(tc::replace(strUuid, '-', '/'), 4)
+	);
+}
+
+// Writes the uuid file atomically so concurrent readers never see a partially written file. Later writes win,
+// like in scripts/RebuildUuidDatabase.py.
+inline void WriteUuidIndexFile(std::basic_string<char> const& strFile, tc::ptr_range<char const> strContent) THROW(tc::file_failure) {
+	NOEXCEPT(boost::filesystem::create_directories(tc::make_str(FilenameWithoutPath<tc::return_take>(strFile))));
+	auto const strFileTemp = tc::make_str(FilenameWithoutPath<tc::return_take>(strFile), tc::unique_name<SBase32CodeTable>());
+	try {
+		tc::append(tc::appendfile(tc::as_c_str(strFileTemp), tc::create_new_tag), strContent); // THROW(tc::file_failure)
+	} catch(tc::file_failure const&) {
+		tc::filesystem::remove_all(tc::as_c_str(strFileTemp));
+		throw;
+	}
+	boost::system::error_code ec;
+	boost::filesystem::rename(strFileTemp, strFile, ec);
+	if(ec) {
+		TRACE("Could not rename ", strFileTemp, " to ", strFile, ": ", ec.message());
+		tc::filesystem::remove_all(tc::as_c_str(strFileTemp));
+		throw tc::file_failure();
+	}
+}
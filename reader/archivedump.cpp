@@ -0,0 +1,162 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "tc/range.h"
+
+#include "PageStore.h"
+#include "Sha1.h"
+#include "UnzipPrefix.h"
+
+// Stores dumps in a SPageStore, so the pages that dumps of the same build have in common are kept only once.
+//
+//	archivedump add <store folder> <dump files>
+//		writes <store folder>/manifests/<SHA-1 of the dump>.manifest for each dump file and prints its name. Dumps are
+//		named by their content because dumps from different machines often have the same file name. The regions.xml
+//		of the dump, if any, is kept next to the manifest as <SHA-1 of the dump>.regions.xml.
+//	archivedump restore <store folder> <manifest file> <dump file>
+//		rebuilds the zipped dump file from the manifest
+
+namespace {
+	std::basic_string<char> AsMegabytes(std::uint64_t cb) noexcept {
+		return tc::make_str(tc::as_dec(cb / (1024 * 1024)), "MB");
+	}
+
+	// The regions.xml that belongs to the manifest strManifest
+	std::basic_string<char> RegionsPath(std::basic_string<char> const& strManifest) noexcept {
+		return boost::filesystem::path(strManifest).replace_extension(".regions.xml").string();
+	}
+
+	int Add(SPageStore& pagestore, std::basic_string<char> const& strStoreFolder, tc::ptr_range<char* const> rngszDump) noexcept {
+		auto const strManifestFolder = tc::make_str(strStoreFolder, "/manifests/");
+		NOEXCEPT(boost::filesystem::create_directories(strManifestFolder));
+
+		int nExitCode = EXIT_SUCCESS;
+		SPageStore::SArchiveStatistics archivestatsTotal;
+		tc::for_each(rngszDump, [&](char const* szDump) noexcept {
+			try {
+				SFileMapping filemappingZip(szDump); // THROW(tc::file_failure)
+				tc::ptr_range<unsigned char const> rngbyteZip = filemappingZip;
+				// minidump.dmp is as large as the memory dumped. It is inflated into a temporary file and mapped, so it is not
+				// held in memory next to the archive.
+				auto const strDumpTemp = tc::make_str(strManifestFolder, tc::unique_name<SBase32CodeTable>(), ".dmp.tmp");
+				scope_exit(tc::filesystem::remove_all(tc::as_c_str(strDumpTemp)));
+				UnzipToFile(rngbyteZip, "minidump.dmp", tc::as_c_str(strDumpTemp)); // THROW(tc::file_failure, ExLoadFail)
+				SFileMapping filemappingDump(tc::as_c_str(strDumpTemp)); // THROW(tc::file_failure)
+				tc::ptr_range<unsigned char const> rngbyteDump = filemappingDump;
+				tc::vector<unsigned char> vecbyteRegions; // dumps written by older versions do not have regions.xml
+				try {
+					vecbyteRegions = CZipFile(rngbyteZip).UnzipFile("regions.xml"); // THROW(ExLoadFail)
+				} catch(ExLoadFail const&) {
+				}
+				SPageStore::SArchiveStatistics archivestats;
+				auto const vecbyteManifest = pagestore.Archive(rngbyteDump, archivestats); // THROW(tc::file_failure)
+
+				auto const strManifest = tc::make_str(strManifestFolder, tc::join(tc::transform(Sha1(rngbyteDump), [](unsigned char byte) noexcept {
+					return tc::as_padded_lc_hex(byte);
+				})), ".manifest");
+				// The same dump added again replaces its identical files. The manifest is written last, so a dump whose manifest
+				// exists is complete.
+				auto WriteFile = [&](std::basic_string<char> const& strFile, tc::ptr_range<unsigned char const> rngbyte) THROW(tc::file_failure) {
+					auto const strFileTemp = tc::make_str(strManifestFolder, tc::unique_name<SBase32CodeTable>());
+					tc::append(tc::appendfile(tc::as_c_str(strFileTemp), tc::create_new_tag), rngbyte); // THROW(tc::file_failure)
+					boost::system::error_code ec;
+					boost::filesystem::rename(strFileTemp, strFile, ec);
+					if(ec) {
+						tc::filesystem::remove_all(tc::as_c_str(strFileTemp));
+						tc::append(tc::cerr(), "[FAILURE] Could not write ", strFile, ": ", ec.message(), "\n");
+						return false;
+					}
+					return true;
+				};
+				if((!tc::empty(vecbyteRegions) && !WriteFile(RegionsPath(strManifest), tc::as_pointers(vecbyteRegions))) // THROW(tc::file_failure)
+					|| !WriteFile(strManifest, tc::as_pointers(vecbyteManifest)) // THROW(tc::file_failure)
+				) {
+					nExitCode = EXIT_FAILURE;
+					return;
+				}
+
+				tc::append(tc::cout(), szDump, " -> ", strManifest, ": ",
+					AsMegabytes(archivestats.m_cbDump), " dump, ",
+					AsMegabytes(archivestats.m_cbNewPages), " new (", AsMegabytes(archivestats.m_cbNewPagesStored), " compressed), ",
+					AsMegabytes(archivestats.m_cbDuplicatePages), " duplicate, ",
+					AsMegabytes(archivestats.m_cbZeroPages), " zero, ",
+					AsMegabytes(archivestats.m_cbLiteral), " literal\n"
+				);
+				archivestatsTotal.m_cbDump += archivestats.m_cbDump;
+				archivestatsTotal.m_cbLiteral += archivestats.m_cbLiteral;
+				archivestatsTotal.m_cbZeroPages += archivestats.m_cbZeroPages;
+				archivestatsTotal.m_cbDuplicatePages += archivestats.m_cbDuplicatePages;
+				archivestatsTotal.m_cbNewPages += archivestats.m_cbNewPages;
+				archivestatsTotal.m_cbNewPagesStored += archivestats.m_cbNewPagesStored;
+			} catch(tc::file_failure const&) {
+				tc::append(tc::cerr(), "[FAILURE] Could not read ", szDump, " or write the page store.\n");
+				nExitCode = EXIT_FAILURE;
+			} catch(ExLoadFail const&) {
+				tc::append(tc::cerr(), "[FAILURE] ", szDump, " is not a dump file.\n");
+				nExitCode = EXIT_FAILURE;
+			}
+		});
+
+		if(0 < archivestatsTotal.m_cbDump) {
+			// Stored bytes are the compressed new pages plus the literal bytes in the manifests
+			auto const cbStored = archivestatsTotal.m_cbNewPagesStored + archivestatsTotal.m_cbLiteral;
+			tc::append(tc::cout(), "Total: ", AsMegabytes(archivestatsTotal.m_cbDump), " of dumps stored in ", AsMegabytes(cbStored),
+				", ", tc::as_dec(cbStored * 100 / archivestatsTotal.m_cbDump), "%\n"
+			);
+		}
+		return nExitCode;
+	}
+
+	int Restore(SPageStore& pagestore, char const* szManifest, char const* szDump) noexcept {
+		auto const strRegions = RegionsPath(tc::make_str(szManifest));
+		auto const strDumpTemp = tc::make_str(szDump, ".dmp.tmp");
+		try {
+			{
+				auto filedump = tc::appendfile(tc::as_c_str(strDumpTemp), tc::create_new_tag); // THROW(tc::file_failure)
+				pagestore.Restore(SFileMapping(szManifest), [&](tc::ptr_range<unsigned char const> rngbyte) THROW(tc::file_failure) {
+					tc::append(filedump, rngbyte); // THROW(tc::file_failure)
+				}); // THROW(tc::file_failure, ExLoadFail)
+			}
+			if(boost::filesystem::exists(strRegions)) {
+				ZipFile(tc::as_c_str(tc::make_str(strDumpTemp, '\0', strRegions, '\0')), "minidump.dmp\0regions.xml\0", szDump);
+			} else {
+				ZipFile(tc::as_c_str(tc::make_str(strDumpTemp, '\0')), "minidump.dmp\0", szDump);
+			}
+			tc::filesystem::remove_all(tc::as_c_str(strDumpTemp));
+			return EXIT_SUCCESS;
+		} catch(tc::file_failure const&) {
+			tc::append(tc::cerr(), "[FAILURE] Could not read ", szManifest, " or write ", szDump, ".\n");
+		} catch(ExLoadFail const&) {
+			tc::append(tc::cerr(), "[FAILURE] ", szManifest, " is not a manifest or refers to pages missing in the page store.\n");
+		}
+		tc::filesystem::remove_all(tc::as_c_str(strDumpTemp));
+		return EXIT_FAILURE;
+	}
+}
+
+int main(int argc, char *argv[]) noexcept { ENTRY
+	auto const rngszArg = tc::counted(argv, argc);
+	bool const bAdd = 4 <= argc && tc::equal(tc::as_c_str(argv[1]), "add");
+	bool const bRestore = 5 == argc && tc::equal(tc::as_c_str(argv[1]), "restore");
+	if(!bAdd && !bRestore) {
+		tc::append(tc::cerr(),
+			"Syntax: archivedump add <store folder> <dump files>\n"
+			"        archivedump restore <store folder> <manifest file> <dump file>\n"
+		);
+		return EXIT_FAILURE;
+	}
+
+	try {
+		SPageStore pagestore(argv[2], /*bWriter*/ bAdd); // THROW(tc::file_failure)
+		return bAdd
+			? Add(pagestore, argv[2], tc::drop_first(rngszArg, 3))
+			: Restore(pagestore, argv[3], argv[4]);
+	} catch(tc::file_failure const&) {
+		tc::append(tc::cerr(), "[FAILURE] Could not open page store ", argv[2], ".\n");
+		return EXIT_FAILURE;
+	}
+EXIT }
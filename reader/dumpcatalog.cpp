@@ -0,0 +1,217 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "tc/range.h"
+
+#include "DumpCatalog.h"
+#include "UnzipPrefix.h"
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+// Builds and queries a SDumpCatalog.
+//
+//	dumpcatalog update <catalog file> <dump files or folders of dump files>
+//		adds new and changed dumps to the catalog and removes dumps that no longer exist. Only the metadata in front of
+//		the core file is unzipped, dumps whose path, modification time and size did not change are not read at all.
+//	dumpcatalog uuid <catalog file> <module uuid>
+//		lists the dumps that loaded the module
+//	dumpcatalog version <catalog file> <bundle version>
+//		lists the dumps written by the bundle version
+//	dumpcatalog threads <catalog file>
+//		counts the dumps of each bundle version by crashed thread
+
+namespace {
+	struct SDumpFile final {
+		std::basic_string<char> m_strPath;
+		std::int64_t m_nModificationTime;
+		std::uint64_t m_cbFile;
+	};
+
+	int Update(char const* szCatalog, tc::ptr_range<char* const> rngszDump) noexcept {
+		SDumpCatalog catalogOld;
+		if(boost::filesystem::exists(szCatalog)) {
+			try {
+				catalogOld = SDumpCatalog::Load(szCatalog); // THROW(tc::file_failure, ExLoadFail)
+			} catch(tc::file_failure const&) {
+				tc::append(tc::cerr(), "[FAILURE] Could not read ", szCatalog, ".\n");
+				return EXIT_FAILURE;
+			} catch(ExLoadFail const&) {
+				tc::append(tc::cerr(), szCatalog, " is not a dump catalog, rebuilding it.\n");
+			}
+		}
+
+		tc::vector<SDumpFile> vecdumpfile;
+		auto AddFile = [&](boost::filesystem::path const& path) noexcept {
+			// The dump may be deleted while we list the folder, skip it then
+			boost::system::error_code ec;
+			auto const nModificationTime = boost::filesystem::last_write_time(path, ec);
+			if(ec) {
+				return;
+			}
+			auto const cbFile = boost::filesystem::file_size(path, ec);
+			if(ec) {
+				return;
+			}
+			tc::cont_emplace_back(vecdumpfile, SDumpFile{path.string(), nModificationTime, cbFile});
+		};
+		tc::for_each(rngszDump, [&](char const* szDump) noexcept {
+			if(boost::filesystem::is_directory(szDump)) {
+				tc::for_each(tc::filesystem::recursive_file_range(szDump), [&](auto&& direntry) noexcept {
+					if(boost::filesystem::is_regular_file(direntry)) {
+						AddFile(direntry.path());
+					}
+				});
+			} else {
+				AddFile(szDump);
+			}
+		});
+		std::sort(tc::begin(vecdumpfile), tc::end(vecdumpfile), [](SDumpFile const& dumpfileLhs, SDumpFile const& dumpfileRhs) noexcept {
+			return dumpfileLhs.m_strPath < dumpfileRhs.m_strPath;
+		});
+
+		// Dumps that did not change keep their row of the old catalog
+		std::unordered_map<std::basic_string<char>, std::size_t> mapstriDumpOld;
+		tc::for_each(tc::iota(std::size_t(0), tc::size(catalogOld.m_dumps)), [&](std::size_t iDump) noexcept {
+			mapstriDumpOld.emplace(tc::make_str(catalogOld.m_dumps.m_colstrPath[iDump]), iDump);
+		});
+		auto UnchangedDumpOld = [&](SDumpFile const& dumpfile) noexcept -> std::optional<std::size_t> {
+			auto const it = mapstriDumpOld.find(dumpfile.m_strPath);
+			if(tc::end(mapstriDumpOld) != it
+				&& catalogOld.m_dumps.m_vecnModificationTime[it->second] == dumpfile.m_nModificationTime
+				&& catalogOld.m_dumps.m_veccbFile[it->second] == dumpfile.m_cbFile
+			) {
+				return it->second;
+			}
+			return std::nullopt;
+		};
+
+		// The dumps are independent, read them on all cores. Each thread takes the next dump that still needs reading.
+		tc::vector<std::optional<SDumpMetaInformation>> vecodumpmetainfo(tc::size(vecdumpfile));
+		std::atomic<std::size_t> iDumpfileNext(0);
+		std::atomic<std::size_t> nDumpsRead(0);
+		std::atomic<std::size_t> nDumpsFailed(0);
+		auto ReadDumps = [&]() noexcept {
+			for(std::size_t iDumpfile = iDumpfileNext++; iDumpfile < tc::size(vecdumpfile); iDumpfile = iDumpfileNext++) {
+				if(UnchangedDumpOld(vecdumpfile[iDumpfile])) {
+					continue;
+				}
+				try {
+					auto const vecbyte = UnzipPrefix(SFileMapping(tc::as_c_str(vecdumpfile[iDumpfile].m_strPath)), "minidump.dmp", tc::range_as_blob("</root>")); // THROW(tc::file_failure, ExLoadFail)
+					vecodumpmetainfo[iDumpfile] = LoadDumpMetaInformation(tc::as_pointers(vecbyte)); // THROW(ExLoadFail)
+					++nDumpsRead;
+				} catch(tc::file_failure const&) {
+					++nDumpsFailed;
+				} catch(ExLoadFail const&) {
+					++nDumpsFailed;
+				}
+			}
+		};
+		{
+			tc::vector<std::thread> vecthread;
+			tc::for_each(tc::iota(1u, std::max(1u, std::thread::hardware_concurrency())), [&](unsigned int) noexcept {
+				tc::cont_emplace_back(vecthread, ReadDumps);
+			});
+			ReadDumps();
+			tc::for_each(vecthread, [](std::thread& thread) noexcept { thread.join(); });
+		}
+
+		// Dumps that could not be read are left out and read again by the next update
+		SDumpCatalog catalog;
+		tc::for_each(tc::iota(std::size_t(0), tc::size(vecdumpfile)), [&](std::size_t iDumpfile) noexcept {
+			auto const& dumpfile = vecdumpfile[iDumpfile];
+			if(auto const oiDumpOld = UnchangedDumpOld(dumpfile)) {
+				catalog.AppendDump(catalogOld, *oiDumpOld);
+			} else if(auto const& odumpmetainfo = vecodumpmetainfo[iDumpfile]) {
+				catalog.AppendDump(dumpfile.m_strPath, dumpfile.m_nModificationTime, dumpfile.m_cbFile, *odumpmetainfo);
+			}
+		});
+		catalog.BuildIndexes();
+
+		try {
+			catalog.Save(szCatalog); // THROW(tc::file_failure)
+		} catch(tc::file_failure const&) {
+			tc::append(tc::cerr(), "[FAILURE] Could not write ", szCatalog, ".\n");
+			return EXIT_FAILURE;
+		}
+		tc::append(tc::cout(),
+			tc::as_dec(tc::size(catalog.m_dumps)), " dumps in catalog, ",
+			tc::as_dec(nDumpsRead.load()), " new or changed dumps read\n"
+		);
+		if(0 != nDumpsFailed) {
+			tc::append(tc::cerr(), "[FAILURE] Could not read ", tc::as_dec(nDumpsFailed.load()), " dumps.\n");
+		}
+		return EXIT_SUCCESS;
+	}
+
+	void PrintDump(SDumpCatalog const& catalog, std::size_t iDump) noexcept {
+		tc::append(tc::cout(),
+			catalog.m_dumps.m_colstrPath[iDump], "\t",
+			catalog.m_dumps.m_colstrExecutable[iDump], "\t",
+			catalog.m_dumps.m_colstrBundleVersion[iDump], "\tthread ",
+			tc::as_dec(catalog.m_dumps.m_vecnThread[iDump]), "\n"
+		);
+	}
+}
+
+int main(int argc, char *argv[]) noexcept { ENTRY
+	auto const rngszArg = tc::counted(argv, argc);
+	auto IsCommand = [&](char const* szCommand, int cArgs) noexcept {
+		return cArgs == argc && tc::equal(tc::as_c_str(argv[1]), tc::as_c_str(szCommand));
+	};
+	if(4 <= argc && tc::equal(tc::as_c_str(argv[1]), "update")) {
+		return Update(argv[2], tc::drop_first(rngszArg, 3));
+	}
+	if(!IsCommand("uuid", 4) && !IsCommand("version", 4) && !IsCommand("threads", 3)) {
+		tc::append(tc::cerr(),
+			"Syntax: dumpcatalog update <catalog file> <dump files or folders of dump files>\n"
+			"        dumpcatalog uuid <catalog file> <module uuid>\n"
+			"        dumpcatalog version <catalog file> <bundle version>\n"
+			"        dumpcatalog threads <catalog file>\n"
+		);
+		return EXIT_FAILURE;
+	}
+
+	SDumpCatalog catalog;
+	try {
+		catalog = SDumpCatalog::Load(argv[2]); // THROW(tc::file_failure, ExLoadFail)
+	} catch(tc::file_failure const&) {
+		tc::append(tc::cerr(), "[FAILURE] Could not read ", argv[2], ".\n");
+		return EXIT_FAILURE;
+	} catch(ExLoadFail const&) {
+		tc::append(tc::cerr(), "[FAILURE] ", argv[2], " is not a dump catalog.\n");
+		return EXIT_FAILURE;
+	}
+
+	if(IsCommand("uuid", 4)) {
+		tc::for_each(catalog.DumpsWithModule(tc::as_c_str(argv[3])), [&](std::uint32_t iDump) noexcept { // any case
+			PrintDump(catalog, iDump);
+		});
+	} else if(IsCommand("version", 4)) {
+		tc::for_each(catalog.DumpsWithBundleVersion(tc::as_c_str(argv[3])), [&](std::uint32_t iDump) noexcept {
+			PrintDump(catalog, iDump);
+		});
+	} else {
+		// m_veciDumpByBundleVersion visits the dumps grouped by bundle version
+		auto const& veciDump = catalog.m_veciDumpByBundleVersion;
+		for(auto itiDump = tc::begin(veciDump); tc::end(veciDump) != itiDump;) {
+			auto const strBundleVersion = catalog.m_dumps.m_colstrBundleVersion[*itiDump];
+			std::map<std::int32_t, std::size_t> mapnThreadcDumps;
+			for(; tc::end(veciDump) != itiDump && tc::equal(catalog.m_dumps.m_colstrBundleVersion[*itiDump], strBundleVersion); ++itiDump) {
+				++mapnThreadcDumps[catalog.m_dumps.m_vecnThread[*itiDump]];
+			}
+			tc::append(tc::cout(), "Bundle version ", strBundleVersion, ":");
+			tc::for_each(mapnThreadcDumps, [](auto const& pairnThreadcDumps) noexcept {
+				tc::append(tc::cout(), " thread ", tc::as_dec(pairnThreadcDumps.first), ": ", tc::as_dec(pairnThreadcDumps.second));
+			});
+			tc::append(tc::cout(), "\n");
+		}
+	}
+	return EXIT_SUCCESS;
+EXIT }
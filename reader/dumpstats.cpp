@@ -0,0 +1,140 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "tc/range.h"
+
+#include "DumpMetaInformation.h"
+#include "UnzipPrefix.h"
+
+#include <map>
+
+// Aggregates the SDumpStatistics that MiniDumpWriteDump records in every dump, grouped by bundle version,
+// so regressions of the dump writer show up as a change between two versions.
+
+namespace {
+	using SDumpStatistics = SDumpMetaInformation::SDumpStatistics;
+
+	struct SPhase final {
+		char const* m_szName;
+		std::uint64_t SDumpStatistics::* m_pn;
+	};
+
+	constexpr SPhase c_aphase[] = {
+		{"suspend", &SDumpStatistics::m_nNanosecondsSuspend},
+		{"threads", &SDumpStatistics::m_nNanosecondsThreads},
+		{"dyldinfo", &SDumpStatistics::m_nNanosecondsDyldInfo},
+		{"modules", &SDumpStatistics::m_nNanosecondsModules},
+		{"regions", &SDumpStatistics::m_nNanosecondsRegions},
+		{"segments", &SDumpStatistics::m_nNanosecondsSegments}
+	};
+
+	struct SVersionStatistics final {
+		tc::vector<SDumpStatistics> m_vecdumpstats;
+		std::size_t m_nDumpsWithoutStatistics = 0;
+	};
+
+	// Nearest-rank percentile, vecn must be sorted
+	std::uint64_t Percentile(tc::vector<std::uint64_t> const& vecn, int nPercent) noexcept {
+		_ASSERT(!tc::empty(vecn));
+		return vecn[(tc::size(vecn) - 1) * nPercent / 100];
+	}
+}
+
+int main(int argc, char *argv[]) noexcept { ENTRY
+	if(argc<2) {
+		tc::append(tc::cerr(), "Syntax: dumpstats <dump files or folders of dump files>\n");
+		return EXIT_FAILURE;
+	}
+
+	std::map<std::basic_string<char>, SVersionStatistics> mapstrversionstats;
+	std::size_t nDumpsFailed = 0;
+
+	auto AddDump = [&](auto const& strFile) noexcept {
+		try {
+			// Only the metadata in front of the core file is inflated
+			auto const vecbyte = UnzipPrefix(SFileMapping(tc::as_c_str(strFile)), "minidump.dmp", tc::range_as_blob("</root>")); // THROW(tc::file_failure, ExLoadFail)
+			auto dumpmetainfo = LoadDumpMetaInformation(tc::as_pointers(vecbyte)); // THROW(ExLoadFail)
+			auto& versionstats = mapstrversionstats[dumpmetainfo.m_strBundleVersion];
+			if(dumpmetainfo.m_odumpstats) {
+				tc::cont_emplace_back(versionstats.m_vecdumpstats, tc_move(*dumpmetainfo.m_odumpstats));
+			} else {
+				++versionstats.m_nDumpsWithoutStatistics;
+			}
+		} catch(tc::file_failure const&) {
+			++nDumpsFailed;
+		} catch(ExLoadFail const&) {
+			++nDumpsFailed;
+		}
+	};
+
+	tc::for_each(tc::iota(1, argc), [&](int iArg) noexcept {
+		if(boost::filesystem::is_directory(argv[iArg])) {
+			tc::for_each(tc::filesystem::recursive_file_range(argv[iArg]), [&](auto&& direntry) noexcept {
+				if(boost::filesystem::is_regular_file(direntry)) {
+					AddDump(direntry.path().string());
+				}
+			});
+		} else {
+			AddDump(tc::make_str(argv[iArg]));
+		}
+	});
+
+	tc::for_each(mapstrversionstats, [&](auto const& pairstrversionstats) noexcept {
+		auto const& vecdumpstats = pairstrversionstats.second.m_vecdumpstats;
+		tc::append(tc::cout(),
+			"Bundle version ", pairstrversionstats.first, ": ",
+			tc::as_dec(tc::size(vecdumpstats)), " dumps, ",
+			tc::as_dec(pairstrversionstats.second.m_nDumpsWithoutStatistics), " without statistics\n");
+		if(tc::empty(vecdumpstats)) {
+			return;
+		}
+
+		auto PrintDistribution = [&](char const* szName, auto fnValue, char const* szUnit) noexcept {
+			auto vecn = tc::make_vector(tc::transform(vecdumpstats, fnValue));
+			tc::sort_inplace(vecn);
+			tc::append(tc::cout(),
+				"\t", szName,
+				": median ", tc::as_dec(Percentile(vecn, 50)), szUnit,
+				", p90 ", tc::as_dec(Percentile(vecn, 90)), szUnit,
+				", p99 ", tc::as_dec(Percentile(vecn, 99)), szUnit,
+				", max ", tc::as_dec(tc::back(vecn)), szUnit, "\n");
+		};
+
+		tc::for_each(c_aphase, [&](SPhase const& phase) noexcept {
+			PrintDistribution(phase.m_szName, [&](SDumpStatistics const& dumpstats) noexcept { return dumpstats.*phase.m_pn / 1000000; }, "ms");
+		});
+		PrintDistribution("regions", [](SDumpStatistics const& dumpstats) noexcept { return dumpstats.m_nRegions; }, "");
+		PrintDistribution("regions mapped", [](SDumpStatistics const& dumpstats) noexcept { return dumpstats.m_nRegionsMapped; }, "");
+		PrintDistribution("regions skipped", [](SDumpStatistics const& dumpstats) noexcept { return dumpstats.m_nRegionsSkipped; }, "");
+		PrintDistribution("regions over budget", [](SDumpStatistics const& dumpstats) noexcept { return dumpstats.m_nRegionsOverBudget; }, "");
+		PrintDistribution("regions remap failed", [](SDumpStatistics const& dumpstats) noexcept { return dumpstats.m_nRegionsRemapFailed; }, "");
+		PrintDistribution("mapped", [](SDumpStatistics const& dumpstats) noexcept { return dumpstats.m_cbMapped / 1024; }, "KB");
+		PrintDistribution("over budget", [](SDumpStatistics const& dumpstats) noexcept { return dumpstats.m_cbOverBudget / 1024; }, "KB");
+		PrintDistribution("mach calls", [](SDumpStatistics const& dumpstats) noexcept {
+			return dumpstats.m_nCallsTaskThreads + dumpstats.m_nCallsThreadInfo + dumpstats.m_nCallsThreadGetState + dumpstats.m_nCallsTaskInfo
+				+ dumpstats.m_nCallsVmReadOverwrite + dumpstats.m_nCallsVmRegion + dumpstats.m_nCallsVmRegionRecurse + dumpstats.m_nCallsVmRemap;
+		}, "");
+
+		// Mapped bytes per user_tag summed over all dumps of this version
+		std::map<unsigned int, std::uint64_t> mapntagcbMapped;
+		tc::for_each(vecdumpstats, [&](SDumpStatistics const& dumpstats) noexcept {
+			tc::for_each(dumpstats.m_vecusertag, [&](SDumpStatistics::SUserTag const& usertag) noexcept {
+				mapntagcbMapped[usertag.m_nUserTag] += usertag.m_cbMapped;
+			});
+		});
+		tc::for_each(mapntagcbMapped, [&](auto const& pairntagcb) noexcept {
+			if(0 != pairntagcb.second) {
+				tc::append(tc::cout(), "\tuser_tag ", tc::as_dec(pairntagcb.first), ": ", tc::as_dec(pairntagcb.second / tc::size(vecdumpstats) / 1024), "KB mapped on average\n");
+			}
+		});
+	});
+
+	if(0 != nDumpsFailed) {
+		tc::append(tc::cerr(), "[FAILURE] Could not read ", tc::as_dec(nDumpsFailed), " dumps.\n");
+	}
+	return EXIT_SUCCESS;
+EXIT }
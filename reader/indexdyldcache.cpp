@@ -0,0 +1,61 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "tc/range.h"
+
+#include "DyldSharedCache.h"
+#include "UuidIndex.h"
+
+// Adds all images of dyld shared caches to the uuid index, so the reader can extract single images on demand
+// instead of us extracting every system library up front. Runs on Linux as well as on macOS.
+
+int main(int argc, char *argv[]) noexcept { ENTRY
+	if(argc<3) {
+		tc::append(tc::cerr(), "Syntax: indexdyldcache <uuid index folder> <dyld shared cache files below ~/mnt/>\n");
+		return EXIT_FAILURE;
+	}
+
+	char const* pszHome = ::getenv("HOME");
+	if (!pszHome || tc::empty(pszHome)) {
+		tc::append(tc::cerr(), "[FAILURE] HOME environment variable must be set.\n");
+		return EXIT_FAILURE;
+	}
+	// The uuid files contain paths relative to ~/mnt/, like the ones written by scripts/RebuildUuidDatabase.py
+	auto const pathMount = boost::filesystem::canonical(tc::make_str(pszHome, "/mnt/"));
+	auto const strUuidsPath = tc::make_str(argv[1], "/");
+
+	int nExitCode = EXIT_SUCCESS;
+	tc::for_each(tc::drop_first(tc::counted(argv, argc), 2), [&](char const* szDyldCache) noexcept {
+		try {
+			auto const odyldcache = SDyldSharedCache::Open(szDyldCache); // THROW(tc::file_failure)
+			if(!odyldcache) {
+				tc::append(tc::cerr(), "[FAILURE] ", szDyldCache, " is not a dyld shared cache.\n");
+				nExitCode = EXIT_FAILURE;
+				return;
+			}
+			auto const strDyldCacheRelative = boost::filesystem::canonical(szDyldCache).lexically_relative(pathMount).string();
+
+			std::size_t cImagesIndexed = 0;
+			tc::for_each(odyldcache->Images(), [&](SDyldSharedCache::SImage const& image) THROW(tc::file_failure) {
+				if(auto const oauuid = odyldcache->ImageUuid(image.m_pvHeader)) {
+					WriteUuidIndexFile(
+						tc::make_str(UuidIndexPath(strUuidsPath, UuidString(*oauuid))),
+						tc::make_str(strDyldCacheRelative, c_chDyldSharedCacheImage, tc::as_lc_hex(image.m_pvHeader))
+					); // THROW(tc::file_failure)
+					++cImagesIndexed;
+				} else {
+					tc::append(tc::cerr(), "\t[FAILED] No uuid found for ", image.m_strPath, "\n");
+				}
+			});
+			tc::append(tc::cout(), szDyldCache, ": ", tc::as_dec(cImagesIndexed), " of ", tc::as_dec(tc::size(odyldcache->Images())), " images indexed\n");
+		} catch(tc::file_failure const&) {
+			tc::append(tc::cerr(), "[FAILURE] Could not read ", szDyldCache, " or write the uuid index.\n");
+			nExitCode = EXIT_FAILURE;
+		}
+	});
+	return nExitCode;
+EXIT }
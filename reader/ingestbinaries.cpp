@@ -0,0 +1,327 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "tc/range.h"
+
+#include "DyldSharedCache.h"
+#include "MachOFormat.h"
+#include "Sha1.h"
+#include "UuidIndex.h"
+
+// Adds the binaries that scripts/CopyMacOSSystemLibraries.py copied for one macOS version to a content-addressed binary store
+// and to the uuid index. Most binaries do not change between macOS updates, so the store grows with the number of distinct
+// binaries instead of the number of macOS versions. Runs on Linux as well as on macOS.
+//
+// Layout below the store folder:
+//	slices/<first two hex digits of SHA-1>/<SHA-1>/<file name>	each 64 bit Mach-O slice, fat binaries are split into their slices
+//	dyldcaches/<cache uuid>/<file names>						each dyld shared cache with its sub caches and .symbols file
+//	versions/<version>.txt										one line per slice or dyld shared cache file of the version:
+//																<path in version>\t<arch or "dyld">\t<uuid>\t<SHA-1>
+//	tmp/														files being written
+//
+// The uuid files point to the slices and to the images in the stored dyld shared caches, so scripts/RebuildUuidDatabase.py
+// and indexdyldcache do not need to parse the copied files again. Once a version has been ingested, its copy can be deleted.
+
+namespace {
+	std::basic_string<char> ArchString(std::uint32_t nCpuType, std::uint32_t nCpuSubtype) noexcept {
+		nCpuSubtype &= macho::c_nCpuSubtypeMask;
+		switch(nCpuType) {
+			case macho::c_nCpuTypeX86_64: return tc::make_str(macho::c_nCpuSubtypeX86_64H == nCpuSubtype ? "x86_64h" : "x86_64");
+			case macho::c_nCpuTypeArm64: return tc::make_str(macho::c_nCpuSubtypeArm64E == nCpuSubtype ? "arm64e" : "arm64");
+			default: return tc::make_str("cputype ", tc::as_dec(nCpuType));
+		}
+	}
+
+	// Calls fn(rngbyteSlice, nCpuType, nCpuSubtype) for each slice of a thin or fat Mach-O file. Returns false if rngbyteFile is not
+	// a Mach-O file. 32 bit slices are not passed to fn, i386 is not supported anymore and lldb cannot debug our dumps with it.
+	template<typename Func>
+	bool ForEachSlice(tc::ptr_range<unsigned char const> rngbyteFile, Func fn) MAYTHROW {
+		auto const onMagic = macho::Read<std::uint32_t>(rngbyteFile, 0);
+		if(!onMagic) {
+			return false;
+		}
+		if(macho::c_nMagic64 == *onMagic) {
+			auto const oheader = macho::Read<macho::mach_header_64>(rngbyteFile, 0);
+			if(!oheader) {
+				return false;
+			}
+			fn(rngbyteFile, std::uint32_t(oheader->cputype), std::uint32_t(oheader->cpusubtype)); // MAYTHROW
+			return true;
+		}
+
+		auto const nMagicFat = macho::FromBigEndian(*onMagic);
+		if(macho::c_nMagicFat != nMagicFat && macho::c_nMagicFat64 != nMagicFat) {
+			return false;
+		}
+		auto const ofatheader = macho::Read<macho::fat_header>(rngbyteFile, 0);
+		if(!ofatheader) {
+			return false;
+		}
+		auto ibArch = sizeof(macho::fat_header);
+		for(std::uint32_t iArch = 0; iArch < macho::FromBigEndian(ofatheader->nfat_arch); ++iArch) {
+			std::uint32_t nCpuType;
+			std::uint32_t nCpuSubtype;
+			std::uint64_t ibSlice;
+			std::uint64_t cbSlice;
+			if(macho::c_nMagicFat == nMagicFat) {
+				auto const ofatarch = macho::Read<macho::fat_arch>(rngbyteFile, ibArch);
+				if(!ofatarch) {
+					return false;
+				}
+				nCpuType = macho::FromBigEndian(std::uint32_t(ofatarch->cputype));
+				nCpuSubtype = macho::FromBigEndian(std::uint32_t(ofatarch->cpusubtype));
+				ibSlice = macho::FromBigEndian(ofatarch->offset);
+				cbSlice = macho::FromBigEndian(ofatarch->size);
+				ibArch += sizeof(macho::fat_arch);
+			} else {
+				auto const ofatarch = macho::Read<macho::fat_arch_64>(rngbyteFile, ibArch);
+				if(!ofatarch) {
+					return false;
+				}
+				nCpuType = macho::FromBigEndian(std::uint32_t(ofatarch->cputype));
+				nCpuSubtype = macho::FromBigEndian(std::uint32_t(ofatarch->cpusubtype));
+				ibSlice = macho::FromBigEndian(ofatarch->offset);
+				cbSlice = macho::FromBigEndian(ofatarch->size);
+				ibArch += sizeof(macho::fat_arch_64);
+			}
+			if(tc::size(rngbyteFile) < ibSlice || tc::size(rngbyteFile) - ibSlice < cbSlice) {
+				return false;
+			}
+			auto const rngbyteSlice = tc::take_first(tc::drop_first(rngbyteFile, ibSlice), cbSlice);
+			if(macho::c_nCpuTypeI386 != nCpuType && macho::Read<std::uint32_t>(rngbyteSlice, 0) == macho::c_nMagic64) {
+				fn(rngbyteSlice, nCpuType, nCpuSubtype); // MAYTHROW
+			}
+		}
+		return true;
+	}
+
+	// Like WriteUuidIndexFile, concurrent readers never see a partially written file. The temporary file is written to
+	// strTempFolder, so the folders of the store only contain complete files.
+	void WriteFileAtomically(std::basic_string<char> const& strTempFolder, std::basic_string<char> const& strFile, tc::ptr_range<unsigned char const> rngbyte) THROW(tc::file_failure) {
+		NOEXCEPT(boost::filesystem::create_directories(tc::make_str(FilenameWithoutPath<tc::return_take>(strFile))));
+		NOEXCEPT(boost::filesystem::create_directories(strTempFolder));
+		auto const strFileTemp = tc::make_str(strTempFolder, tc::unique_name<SBase32CodeTable>());
+		try {
+			tc::append(tc::appendfile(tc::as_c_str(strFileTemp), tc::create_new_tag), rngbyte); // THROW(tc::file_failure)
+		} catch(tc::file_failure const&) {
+			tc::filesystem::remove_all(tc::as_c_str(strFileTemp));
+			throw;
+		}
+		boost::system::error_code ec;
+		boost::filesystem::rename(strFileTemp, strFile, ec);
+		if(ec) {
+			TRACE("Could not rename ", strFileTemp, " to ", strFile, ": ", ec.message());
+			tc::filesystem::remove_all(tc::as_c_str(strFileTemp));
+			throw tc::file_failure();
+		}
+	}
+
+	boost::filesystem::path Canonical(boost::filesystem::path const& path) THROW(tc::file_failure) {
+		boost::system::error_code ec;
+		auto pathCanonical = boost::filesystem::canonical(path, ec);
+		if(ec) {
+			TRACE("Could not resolve ", path.string(), ": ", ec.message());
+			throw tc::file_failure();
+		}
+		return pathCanonical;
+	}
+
+	std::basic_string<char> Sha1String(tc::ptr_range<unsigned char const> rngbyte) noexcept {
+		return tc::make_str(tc::join(tc::transform(Sha1(rngbyte), [](unsigned char byte) noexcept {
+			return tc::as_padded_lc_hex(byte);
+		})));
+	}
+
+	// The first file of slices/<first two hex digits>/<strSha1>/, whatever its name, so a slice seen under another file name before is reused.
+	// Returns std::nullopt if the slice is not in the store yet.
+	std::optional<std::basic_string<char>> StoredSlice(std::basic_string<char> const& strStore, std::basic_string<char> const& strSha1) noexcept {
+		auto const strSliceFolder = tc::make_str("slices/", tc::take_first(strSha1, 2), "/", strSha1, "/");
+		boost::system::error_code ec;
+		for(boost::filesystem::directory_iterator it(tc::make_str(strStore, strSliceFolder), ec), itEnd; !ec && itEnd != it; it.increment(ec)) {
+			if(boost::filesystem::is_regular_file(it->symlink_status(ec))) {
+				return tc::make_str(strSliceFolder, it->path().filename().string());
+			}
+		}
+		return std::nullopt;
+	}
+}
+
+int main(int argc, char *argv[]) noexcept { ENTRY
+	if(argc!=5) {
+		tc::append(tc::cerr(), "Syntax: ingestbinaries <uuid index folder> <binary store folder below ~/mnt/> <version, e.g., 12.6_21G115> <folder of copied binaries>\n");
+		return EXIT_FAILURE;
+	}
+
+	char const* pszHome = ::getenv("HOME");
+	if (!pszHome || tc::empty(pszHome)) {
+		tc::append(tc::cerr(), "[FAILURE] HOME environment variable must be set.\n");
+		return EXIT_FAILURE;
+	}
+	auto const strUuidsPath = tc::make_str(argv[1], "/");
+	boost::filesystem::path pathMount;
+	boost::filesystem::path pathStore;
+	boost::filesystem::path pathVersion;
+	try {
+		// The uuid files contain paths relative to ~/mnt/, like the ones written by scripts/RebuildUuidDatabase.py
+		pathMount = Canonical(tc::make_str(pszHome, "/mnt/")); // THROW(tc::file_failure)
+		NOEXCEPT(boost::filesystem::create_directories(argv[2]));
+		pathStore = Canonical(argv[2]); // THROW(tc::file_failure)
+		pathVersion = Canonical(argv[4]); // THROW(tc::file_failure)
+	} catch(tc::file_failure const&) {
+		tc::append(tc::cerr(), "[FAILURE] ~/mnt/, ", argv[2], " or ", argv[4], " does not exist.\n");
+		return EXIT_FAILURE;
+	}
+	auto const strStore = tc::make_str(pathStore.string(), "/");
+	auto const strStoreRelative = pathStore.lexically_relative(pathMount).string();
+	auto const strTempFolder = tc::make_str(strStore, "tmp/");
+
+	std::basic_string<char> strManifest;
+	std::size_t nSlices = 0;
+	std::size_t nSlicesNew = 0;
+	std::uint64_t cbSlices = 0;
+	std::uint64_t cbSlicesNew = 0;
+	tc::vector<boost::filesystem::path> vecpathDyldCache; // files that start like a dyld shared cache, main caches as well as sub caches
+	int nExitCode = EXIT_SUCCESS;
+
+	auto AddFile = [&](boost::filesystem::path const& pathFile) noexcept {
+		try {
+			SFileMapping filemapping(tc::as_c_str(pathFile.string())); // THROW(tc::file_failure)
+			if(tc::starts_with<tc::return_bool>(tc::as_typed_range<char>(tc::ptr_range<unsigned char const>(filemapping)), "dyld_v1")) {
+				tc::cont_emplace_back(vecpathDyldCache, pathFile);
+				return;
+			}
+			// Other files that are not Mach-O files, e.g., plists and scripts, are skipped silently
+			ForEachSlice(filemapping, [&](tc::ptr_range<unsigned char const> rngbyteSlice, std::uint32_t nCpuType, std::uint32_t nCpuSubtype) THROW(tc::file_failure) {
+				auto const oauuid = macho::Uuid(rngbyteSlice, 0);
+				if(!oauuid) {
+					tc::append(tc::cerr(), "\t[FAILED] No uuid found in ", pathFile.string(), " ", ArchString(nCpuType, nCpuSubtype), "\n");
+					return;
+				}
+				auto const strUuid = UuidString(*oauuid);
+				auto const strSha1 = Sha1String(rngbyteSlice);
+
+				++nSlices;
+				cbSlices += tc::size(rngbyteSlice);
+				auto ostrSlice = StoredSlice(strStore, strSha1);
+				if(!ostrSlice) {
+					ostrSlice = tc::make_str("slices/", tc::take_first(strSha1, 2), "/", strSha1, "/", pathFile.filename().string());
+					WriteFileAtomically(strTempFolder, tc::make_str(strStore, *ostrSlice), rngbyteSlice); // THROW(tc::file_failure)
+					++nSlicesNew;
+					cbSlicesNew += tc::size(rngbyteSlice);
+				}
+				// Later writes win, like in scripts/RebuildUuidDatabase.py. The uuid of a slice identifies its content,
+				// so a uuid file that points to an older slice still points to the same binary.
+				WriteUuidIndexFile(tc::make_str(UuidIndexPath(strUuidsPath, strUuid)), tc::make_str(strStoreRelative, "/", *ostrSlice)); // THROW(tc::file_failure)
+				tc::append(strManifest, pathFile.lexically_relative(pathVersion).string(), "\t", ArchString(nCpuType, nCpuSubtype), "\t", strUuid, "\t", strSha1, "\n");
+			});
+		} catch(tc::file_failure const&) {
+			tc::append(tc::cerr(), "[FAILURE] Could not read ", pathFile.string(), " or write the binary store.\n");
+			nExitCode = EXIT_FAILURE;
+		}
+	};
+
+	{
+		// A folder that cannot be listed ends the walk. The files found so far are still stored, but the version is reported as failed.
+		boost::system::error_code ec;
+		for(boost::filesystem::recursive_directory_iterator it(pathVersion, ec), itEnd; !ec && itEnd != it; it.increment(ec)) {
+			auto const status = it->symlink_status(ec);
+			if(ec) {
+				tc::append(tc::cerr(), "[FAILURE] Could not get the status of ", it->path().string(), ": ", ec.message(), "\n");
+				nExitCode = EXIT_FAILURE;
+				ec.clear();
+			} else if(boost::filesystem::is_directory(status)) {
+				// Don't recurse into *.dSYM folders, like scripts/RebuildUuidDatabase.py
+				if(tc::ends_with<tc::return_bool>(it->path().filename().string(), ".dSYM")) {
+					it.disable_recursion_pending();
+				}
+			} else if(boost::filesystem::is_regular_file(status)) {
+				AddFile(it->path());
+			}
+		}
+		if(ec) {
+			tc::append(tc::cerr(), "[FAILURE] Could not list the files in ", pathVersion.string(), ": ", ec.message(), "\n");
+			nExitCode = EXIT_FAILURE;
+		}
+	}
+
+	// The images of a dyld shared cache are not separate files. Store the cache files as they are, under the uuid of the cache,
+	// and index the images like indexdyldcache does. The sub caches and the .symbols file must stay next to the main cache
+	// with the same names, so they are stored in the folder of their main cache.
+	std::size_t nDyldCaches = 0;
+	std::size_t nDyldCachesNew = 0;
+	tc::for_each(vecpathDyldCache, [&](boost::filesystem::path const& pathFile) noexcept {
+		try {
+			auto const odyldcache = SDyldSharedCache::Open(pathFile.string()); // THROW(tc::file_failure)
+			if(!odyldcache || tc::empty(odyldcache->Images())) {
+				return; // sub caches and .symbols files have no images, they are stored with their main cache
+			}
+			auto const oheader = macho::Read<macho::dyld_cache_header>(SFileMapping(tc::as_c_str(pathFile.string())), 0); // THROW(tc::file_failure)
+			std::array<std::uint8_t, 16> auuidCache;
+			std::memcpy(auuidCache.data(), VERIFY(oheader)->uuid, 16); // checked by SDyldSharedCache::Open
+			auto const strUuidCache = UuidString(auuidCache);
+			auto const strFolder = tc::make_str("dyldcaches/", strUuidCache, "/");
+			auto const strMainCache = tc::make_str(strFolder, pathFile.filename().string());
+
+			++nDyldCaches;
+			tc::vector<boost::filesystem::path> vecpathCacheFile;
+			auto const strPrefix = tc::make_str(pathFile.filename().string(), ".");
+			tc::for_each(vecpathDyldCache, [&](boost::filesystem::path const& pathOther) noexcept {
+				if(pathOther.parent_path() == pathFile.parent_path() && tc::starts_with<tc::return_bool>(pathOther.filename().string(), strPrefix)) {
+					tc::cont_emplace_back(vecpathCacheFile, pathOther);
+				}
+			});
+			tc::cont_emplace_back(vecpathCacheFile, pathFile);
+			tc::for_each(vecpathCacheFile, [&](boost::filesystem::path const& pathCacheFile) THROW(tc::file_failure) {
+				SFileMapping filemapping(tc::as_c_str(pathCacheFile.string())); // THROW(tc::file_failure)
+				tc::append(strManifest, pathCacheFile.lexically_relative(pathVersion).string(), "\tdyld\t", strUuidCache, "\t", Sha1String(filemapping), "\n");
+			});
+			// The main cache is written last, so a stored main cache implies that its sub caches are complete
+			boost::system::error_code ec;
+			bool const bStored = boost::filesystem::exists(tc::make_str(strStore, strMainCache), ec);
+			if(ec) {
+				TRACE("Could not check for ", strMainCache, " in the binary store: ", ec.message());
+				throw tc::file_failure();
+			}
+			if(!bStored) {
+				tc::for_each(vecpathCacheFile, [&](boost::filesystem::path const& pathCacheFile) THROW(tc::file_failure) {
+					WriteFileAtomically(strTempFolder, tc::make_str(strStore, strFolder, pathCacheFile.filename().string()), SFileMapping(tc::as_c_str(pathCacheFile.string()))); // THROW(tc::file_failure)
+				});
+				++nDyldCachesNew;
+			}
+
+			std::size_t cImagesIndexed = 0;
+			tc::for_each(odyldcache->Images(), [&](SDyldSharedCache::SImage const& image) THROW(tc::file_failure) {
+				if(auto const oauuid = odyldcache->ImageUuid(image.m_pvHeader)) {
+					WriteUuidIndexFile(
+						tc::make_str(UuidIndexPath(strUuidsPath, UuidString(*oauuid))),
+						tc::make_str(strStoreRelative, "/", strMainCache, c_chDyldSharedCacheImage, tc::as_lc_hex(image.m_pvHeader))
+					); // THROW(tc::file_failure)
+					++cImagesIndexed;
+				} else {
+					tc::append(tc::cerr(), "\t[FAILED] No uuid found for ", image.m_strPath, "\n");
+				}
+			});
+			tc::append(tc::cout(), pathFile.string(), ": ", tc::as_dec(cImagesIndexed), " of ", tc::as_dec(tc::size(odyldcache->Images())), " images indexed\n");
+		} catch(tc::file_failure const&) {
+			tc::append(tc::cerr(), "[FAILURE] Could not read ", pathFile.string(), " or write the binary store.\n");
+			nExitCode = EXIT_FAILURE;
+		}
+	});
+
+	try {
+		WriteFileAtomically(strTempFolder, tc::make_str(strStore, "versions/", argv[3], ".txt"), tc::range_as_blob(strManifest)); // THROW(tc::file_failure)
+	} catch(tc::file_failure const&) {
+		tc::append(tc::cerr(), "[FAILURE] Could not write the manifest of ", argv[3], ".\n");
+		return EXIT_FAILURE;
+	}
+	tc::append(tc::cout(), argv[3], ": ",
+		tc::as_dec(nSlices), " slices with ", tc::as_dec(cbSlices / (1024 * 1024)), "MB, ",
+		tc::as_dec(nSlicesNew), " new slices with ", tc::as_dec(cbSlicesNew / (1024 * 1024)), "MB, ",
+		tc::as_dec(nDyldCaches), " dyld shared caches, ", tc::as_dec(nDyldCachesNew), " new\n"
+	);
+	return nExitCode;
+EXIT }
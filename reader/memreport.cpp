@@ -0,0 +1,413 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "tc/range.h"
+
+#include "DumpMetaInformation.h"
+#include "MachOFormat.h"
+#include "PageScan.h"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+
+// Shows which memory holds the bytes of a dumped process: totals by VM user_tag, protection and module, and for the dumped
+// malloc regions how much of them are zero pages and how well the rest would compress. Reads the core file directly, without lldb.
+// Pass the unzipped minidump.dmp of big dumps, it is memory-mapped instead of unzipped into memory. The regions.xml of the dump
+// is then read from the same folder.
+
+namespace {
+	// VM_MEMORY_XXX in <mach/vm_statistics.h>, which does not exist on Linux
+	char const* UserTagName(unsigned int nUserTag) noexcept {
+		switch(nUserTag) {
+			case 0: return "untagged";
+			case 1: return "MALLOC";
+			case 2: return "MALLOC_SMALL";
+			case 3: return "MALLOC_LARGE";
+			case 4: return "MALLOC_HUGE";
+			case 5: return "SBRK";
+			case 6: return "REALLOC";
+			case 7: return "MALLOC_TINY";
+			case 8: return "MALLOC_LARGE_REUSABLE";
+			case 9: return "MALLOC_LARGE_REUSED";
+			case 10: return "ANALYSIS_TOOL";
+			case 11: return "MALLOC_NANO";
+			case 12: return "MALLOC_MEDIUM";
+			case 20: return "MACH_MSG";
+			case 21: return "IOKIT";
+			case 30: return "STACK";
+			case 31: return "GUARD";
+			case 32: return "SHARED_PMAP";
+			case 33: return "DYLIB";
+			case 34: return "OBJC_DISPATCHERS";
+			case 35: return "UNSHARED_PMAP";
+			case 40: return "APPKIT";
+			case 41: return "FOUNDATION";
+			case 42: return "COREGRAPHICS";
+			case 43: return "CORESERVICES";
+			case 44: return "JAVA";
+			case 45: return "COREDATA";
+			case 46: return "COREDATA_OBJECTIDS";
+			case 50: return "ATS";
+			case 51: return "LAYERKIT";
+			case 52: return "CGIMAGE";
+			case 53: return "TCMALLOC";
+			case 54: return "COREGRAPHICS_DATA";
+			case 55: return "COREGRAPHICS_SHARED";
+			case 56: return "COREGRAPHICS_FRAMEBUFFERS";
+			case 57: return "COREGRAPHICS_BACKINGSTORES";
+			case 58: return "COREGRAPHICS_XALLOC";
+			case 60: return "DYLD";
+			case 61: return "DYLD_MALLOC";
+			case 62: return "SQLITE";
+			case 63: return "JAVASCRIPT_CORE";
+			case 64: return "JAVASCRIPT_JIT_EXECUTABLE_ALLOCATOR";
+			case 65: return "JAVASCRIPT_JIT_REGISTER_FILE";
+			case 66: return "GLSL";
+			case 67: return "OPENCL";
+			case 68: return "COREIMAGE";
+			case 69: return "WEBCORE_PURGEABLE_BUFFERS";
+			case 70: return "IMAGEIO";
+			case 71: return "COREPROFILE";
+			case 72: return "ASSETSD";
+			case 73: return "OS_ALLOC_ONCE";
+			case 74: return "LIBDISPATCH";
+			case 75: return "ACCELERATE";
+			case 76: return "COREUI";
+			case 77: return "COREUIFILE";
+			case 78: return "GENEALOGY";
+			case 79: return "RAWCAMERA";
+			case 80: return "CORPSEINFO";
+			case 81: return "ASL";
+			case 82: return "SWIFT_RUNTIME";
+			case 83: return "SWIFT_METADATA";
+			case 84: return "DHMM";
+			case 86: return "SCENEKIT";
+			case 87: return "SKYWALK";
+			case 88: return "IOSURFACE";
+			case 89: return "LIBNETWORK";
+			case 90: return "AUDIO";
+			case 91: return "VIDEOBITSTREAM";
+			default: return nullptr;
+		}
+	}
+
+	std::basic_string<char> UserTagString(unsigned int nUserTag) noexcept {
+		if(auto const szName = UserTagName(nUserTag)) {
+			return tc::make_str(szName);
+		}
+		return tc::make_str("user_tag ", tc::as_dec(nUserTag));
+	}
+
+	bool IsMallocUserTag(unsigned int nUserTag) noexcept {
+		switch(nUserTag) {
+			case 1: case 2: case 3: case 4: case 6: case 7: case 8: case 9: case 11: case 12:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	std::basic_string<char> ProtectionString(int nProtection) noexcept {
+		return tc::make_str(
+			(nProtection & 0x1) ? "r" : "-", // VM_PROT_READ
+			(nProtection & 0x2) ? "w" : "-", // VM_PROT_WRITE
+			(nProtection & 0x4) ? "x" : "-" // VM_PROT_EXECUTE
+		);
+	}
+
+	std::basic_string<char> AsMegabytes(std::uint64_t cb) noexcept {
+		return tc::make_str(tc::as_dec(cb / (1024 * 1024)), "MB");
+	}
+
+	struct STotal final {
+		std::uint64_t m_cb = 0;
+		std::uint64_t m_cbMapped = 0;
+	};
+
+	template<typename Key, typename Func>
+	void PrintTotals(char const* szTitle, std::map<Key, STotal> const& mapkeytotal, Func fnName, std::size_t nMax) noexcept {
+		auto vecpairkeytotal = tc::make_vector(tc::transform(mapkeytotal, [](auto const& pairkeytotal) noexcept {
+			return std::make_pair(pairkeytotal.first, pairkeytotal.second);
+		}));
+		std::stable_sort(tc::begin(vecpairkeytotal), tc::end(vecpairkeytotal), [](auto const& pairLhs, auto const& pairRhs) noexcept {
+			return pairRhs.second.m_cb < pairLhs.second.m_cb;
+		});
+		tc::append(tc::cout(), szTitle, " (virtual size, dumped size)\n");
+		tc::for_each(tc::take_first(vecpairkeytotal, std::min(nMax, tc::size(vecpairkeytotal))), [&](auto const& pairkeytotal) noexcept {
+			tc::append(tc::cout(), "\t", fnName(pairkeytotal.first), ": ", AsMegabytes(pairkeytotal.second.m_cb), ", ", AsMegabytes(pairkeytotal.second.m_cbMapped), "\n");
+		});
+	}
+
+	struct SSegment final {
+		std::uint64_t m_pvBegin;
+		std::uint64_t m_cb;
+		int m_nProtection;
+		tc::ptr_range<unsigned char const> m_rngbyte; // dumped content, empty if the segment is not mapped
+	};
+
+	// Zero pages and byte histogram of the non-zero pages of the malloc regions with one user_tag
+	struct SHeapScan final {
+		std::uint64_t m_cbScanned = 0;
+		std::uint64_t m_cbZeroPages = 0;
+		SByteHistogram m_bytehistogram;
+
+		void Add(SHeapScan const& heapscan) & noexcept {
+			m_cbScanned += heapscan.m_cbScanned;
+			m_cbZeroPages += heapscan.m_cbZeroPages;
+			m_bytehistogram.Add(heapscan.m_bytehistogram);
+		}
+	};
+
+	// Large regions are split, so the threads finish at about the same time
+	constexpr std::size_t c_cbScanChunk = 16 * 1024 * 1024;
+	static_assert(0 == c_cbScanChunk % c_cbScanPage);
+
+	struct SScanChunk final {
+		tc::ptr_range<unsigned char const> m_rngbyte;
+		unsigned int m_nUserTag;
+	};
+
+	void Report(char const* szDump, unsigned int nThreads) THROW(tc::file_failure, ExLoadFail) {
+		SFileMapping filemapping(szDump); // THROW(tc::file_failure)
+		tc::ptr_range<unsigned char const> rngbyteDump = filemapping;
+		tc::vector<unsigned char> vecbyteUnzipped;
+		std::optional<SFileMapping> ofilemappingRegions;
+		tc::vector<unsigned char> vecbyteRegions; // dumps written by older versions do not have regions.xml
+		if(tc::starts_with<tc::return_bool>(rngbyteDump, tc::range_as_blob("<?xml"))) {
+			auto const strRegions = (boost::filesystem::path(szDump).parent_path() / "regions.xml").string();
+			if(boost::filesystem::exists(strRegions)) {
+				ofilemappingRegions.emplace(tc::as_c_str(strRegions)); // THROW(tc::file_failure)
+			}
+		} else {
+			CZipFile zipfile(rngbyteDump);
+			vecbyteUnzipped = zipfile.UnzipFile("minidump.dmp"); // THROW(ExLoadFail)
+			rngbyteDump = tc::as_pointers(vecbyteUnzipped);
+			try {
+				vecbyteRegions = zipfile.UnzipFile("regions.xml"); // THROW(ExLoadFail)
+			} catch(ExLoadFail const&) {
+			}
+		}
+		auto const dumpmetainfo = LoadDumpMetaInformation(rngbyteDump); // THROW(ExLoadFail)
+		auto vecregion = ofilemappingRegions
+			? LoadDumpRegions(*ofilemappingRegions) // THROW(ExLoadFail)
+			: LoadDumpRegions(tc::as_pointers(vecbyteRegions)); // THROW(ExLoadFail)
+		auto const rngbyteCore = tc::drop(rngbyteDump, tc::search<tc::return_border_after>(rngbyteDump, tc::range_as_blob("</root>")));
+
+		tc::vector<SSegment> vecsegment;
+		if(!macho::ForEachLoadCommand(rngbyteCore, 0, [&](macho::load_command const& loadcmd, std::uint64_t ibCommand) noexcept {
+			if(macho::c_nLcSegment64 == loadcmd.cmd) {
+				if(auto const osegcmd = macho::Read<macho::segment_command_64>(rngbyteCore, ibCommand)) {
+					bool const bInCore = osegcmd->fileoff <= tc::size(rngbyteCore) && osegcmd->filesize <= tc::size(rngbyteCore) - osegcmd->fileoff;
+					tc::cont_emplace_back(vecsegment, SSegment{
+						osegcmd->vmaddr,
+						osegcmd->vmsize,
+						osegcmd->initprot,
+						bInCore ? tc::take_first(tc::drop_first(rngbyteCore, osegcmd->fileoff), osegcmd->filesize) : tc::ptr_range<unsigned char const>()
+					});
+				}
+			}
+		})) {
+			throw ExLoadFail();
+		}
+		std::sort(tc::begin(vecsegment), tc::end(vecsegment), [](SSegment const& segmentLhs, SSegment const& segmentRhs) noexcept {
+			return segmentLhs.m_pvBegin < segmentRhs.m_pvBegin;
+		});
+		// Dumped bytes from pv to the end of its segment
+		auto Memory = [&](std::uint64_t pv) noexcept -> tc::ptr_range<unsigned char const> {
+			auto const itsegment = std::upper_bound(tc::begin(vecsegment), tc::end(vecsegment), pv, [](std::uint64_t pv, SSegment const& segment) noexcept {
+				return pv < segment.m_pvBegin;
+			});
+			if(tc::begin(vecsegment) == itsegment) {
+				return {};
+			}
+			auto const& segment = *std::prev(itsegment);
+			if(tc::size(segment.m_rngbyte) <= pv - segment.m_pvBegin) {
+				return {};
+			}
+			return tc::drop_first(segment.m_rngbyte, pv - segment.m_pvBegin);
+		};
+
+		// Dumps written by older versions do not have regions.xml. The segments still tell address, size and whether they were dumped.
+		bool const bUserTags = !tc::empty(vecregion);
+		if(!bUserTags) {
+			tc::append(tc::cout(), "No region information in dump, showing segments of the core file without user_tag.\n");
+			tc::for_each(vecsegment, [&](SSegment const& segment) noexcept {
+				tc::cont_emplace_back(vecregion, SDumpMetaInformation::SRegion{segment.m_pvBegin, segment.m_cb, segment.m_nProtection, 0, 0, !tc::empty(segment.m_rngbyte)});
+			});
+		}
+
+		tc::append(tc::cout(), szDump, ": ", dumpmetainfo.m_strExecutable, " ", dumpmetainfo.m_strBundleVersion, "\n");
+
+		std::map<unsigned int, STotal> mapntagtotal;
+		std::map<int, STotal> mapnprottotal;
+		STotal totalAll;
+		tc::for_each(vecregion, [&](SDumpMetaInformation::SRegion const& region) noexcept {
+			auto Add = [&](STotal& total) noexcept {
+				total.m_cb += region.m_cb;
+				if(region.m_bMapped) {
+					total.m_cbMapped += region.m_cb;
+				}
+			};
+			Add(mapntagtotal[region.m_nUserTag]);
+			Add(mapnprottotal[region.m_nProtection]);
+			Add(totalAll);
+		});
+		tc::append(tc::cout(), "Total: ", AsMegabytes(totalAll.m_cb), ", ", AsMegabytes(totalAll.m_cbMapped), " dumped\n");
+		if(bUserTags) {
+			PrintTotals("By user_tag", mapntagtotal, UserTagString, std::numeric_limits<std::size_t>::max());
+		}
+		PrintTotals("By protection", mapnprottotal, ProtectionString, std::numeric_limits<std::size_t>::max());
+
+		// Module address ranges from the segments of their mach headers, if the header was dumped. The __LINKEDIT segments of
+		// images in the dyld shared cache all point to the same memory, so __LINKEDIT is not attributed to any module.
+		{
+			struct SModuleRange final {
+				std::uint64_t m_pvBegin;
+				std::uint64_t m_pvEnd;
+				std::size_t m_iModule;
+			};
+			tc::vector<SModuleRange> vecmodulerange;
+			std::size_t nModulesWithoutHeader = 0;
+			tc::for_each(tc::iota(std::size_t(0), tc::size(dumpmetainfo.m_vecmodule)), [&](std::size_t iModule) noexcept {
+				auto const pvHeader = dumpmetainfo.m_vecmodule[iModule].m_pvStartAddress;
+				auto const rngbyteHeader = Memory(pvHeader);
+				std::optional<std::uint64_t> opvTextUnslid;
+				tc::vector<macho::segment_command_64> vecsegcmd;
+				if(!macho::ForEachLoadCommand(rngbyteHeader, 0, [&](macho::load_command const& loadcmd, std::uint64_t ibCommand) noexcept {
+					if(macho::c_nLcSegment64 == loadcmd.cmd) {
+						if(auto const osegcmd = macho::Read<macho::segment_command_64>(rngbyteHeader, ibCommand)) {
+							if(0 == osegcmd->fileoff && 0 != osegcmd->filesize) {
+								opvTextUnslid = osegcmd->vmaddr;
+							}
+							if(0 != std::strncmp(osegcmd->segname, "__PAGEZERO", sizeof(osegcmd->segname))
+								&& 0 != std::strncmp(osegcmd->segname, "__LINKEDIT", sizeof(osegcmd->segname))
+							) {
+								tc::cont_emplace_back(vecsegcmd, *osegcmd);
+							}
+						}
+					}
+				}) || !opvTextUnslid) {
+					++nModulesWithoutHeader;
+					return;
+				}
+				tc::for_each(vecsegcmd, [&](macho::segment_command_64 const& segcmd) noexcept {
+					auto const pvBegin = segcmd.vmaddr - *opvTextUnslid + pvHeader;
+					tc::cont_emplace_back(vecmodulerange, SModuleRange{pvBegin, pvBegin + segcmd.vmsize, iModule});
+				});
+			});
+
+			std::map<std::size_t, STotal> mapimoduletotal;
+			tc::for_each(vecmodulerange, [&](SModuleRange const& modulerange) noexcept {
+				auto itregion = std::partition_point(tc::begin(vecregion), tc::end(vecregion), [&](SDumpMetaInformation::SRegion const& region) noexcept {
+					return region.m_pvBegin + region.m_cb <= modulerange.m_pvBegin;
+				});
+				for(; tc::end(vecregion) != itregion && itregion->m_pvBegin < modulerange.m_pvEnd; ++itregion) {
+					auto const cbOverlap = std::min(modulerange.m_pvEnd, itregion->m_pvBegin + itregion->m_cb) - std::max(modulerange.m_pvBegin, itregion->m_pvBegin);
+					auto& total = mapimoduletotal[modulerange.m_iModule];
+					total.m_cb += cbOverlap;
+					if(itregion->m_bMapped) {
+						total.m_cbMapped += cbOverlap;
+					}
+				}
+			});
+			PrintTotals("Largest modules", mapimoduletotal, [&](std::size_t iModule) noexcept {
+				return dumpmetainfo.m_vecmodule[iModule].m_strPath;
+			}, 20);
+			if(0 != nModulesWithoutHeader) {
+				tc::append(tc::cout(), "\t", tc::as_dec(nModulesWithoutHeader), " modules without dumped mach header\n");
+			}
+		}
+
+		if(!bUserTags) {
+			return;
+		}
+
+		// Scan the dumped malloc regions on nThreads threads. Each thread sums into its own SHeapScan per user_tag.
+		auto const tpStart = std::chrono::steady_clock::now();
+		tc::vector<SScanChunk> vecscanchunk;
+		tc::for_each(vecregion, [&](SDumpMetaInformation::SRegion const& region) noexcept {
+			if(region.m_bMapped && IsMallocUserTag(region.m_nUserTag)) {
+				auto rngbyte = Memory(region.m_pvBegin);
+				tc::take_first_inplace(rngbyte, std::min<std::uint64_t>(region.m_cb, tc::size(rngbyte)));
+				while(!tc::empty(rngbyte)) {
+					auto const cb = std::min(c_cbScanChunk, tc::size(rngbyte));
+					tc::cont_emplace_back(vecscanchunk, SScanChunk{tc::take_first(rngbyte, cb), region.m_nUserTag});
+					tc::drop_first_inplace(rngbyte, cb);
+				}
+			}
+		});
+
+		tc::vector<std::map<unsigned int, SHeapScan>> vecmapntagheapscan(nThreads);
+		std::atomic<std::size_t> iScanChunkNext(0);
+		auto Scan = [&](unsigned int iThread) noexcept {
+			auto& mapntagheapscan = vecmapntagheapscan[iThread];
+			for(std::size_t iScanChunk = iScanChunkNext++; iScanChunk < tc::size(vecscanchunk); iScanChunk = iScanChunkNext++) {
+				auto const& scanchunk = vecscanchunk[iScanChunk];
+				auto& heapscan = mapntagheapscan[scanchunk.m_nUserTag];
+				heapscan.m_cbScanned += tc::size(scanchunk.m_rngbyte);
+				auto pb = tc::ptr_begin(scanchunk.m_rngbyte);
+				for(; c_cbScanPage <= tc::ptr_end(scanchunk.m_rngbyte) - pb; pb += c_cbScanPage) {
+					if(IsZeroPage(pb)) {
+						heapscan.m_cbZeroPages += c_cbScanPage;
+					} else {
+						heapscan.m_bytehistogram.Add(tc::counted(pb, c_cbScanPage));
+					}
+				}
+				heapscan.m_bytehistogram.Add(tc::make_iterator_range(pb, tc::ptr_end(scanchunk.m_rngbyte)));
+			}
+		};
+		{
+			tc::vector<std::thread> vecthread;
+			tc::for_each(tc::iota(1u, nThreads), [&](unsigned int iThread) noexcept {
+				tc::cont_emplace_back(vecthread, Scan, iThread);
+			});
+			Scan(0);
+			tc::for_each(vecthread, [](std::thread& thread) noexcept { thread.join(); });
+		}
+
+		std::map<unsigned int, SHeapScan> mapntagheapscan;
+		SHeapScan heapscanAll;
+		tc::for_each(vecmapntagheapscan, [&](auto const& mapntagheapscanThread) noexcept {
+			tc::for_each(mapntagheapscanThread, [&](auto const& pairntagheapscan) noexcept {
+				mapntagheapscan[pairntagheapscan.first].Add(pairntagheapscan.second);
+				heapscanAll.Add(pairntagheapscan.second);
+			});
+		});
+		auto PrintHeapScan = [](auto const& strName, SHeapScan const& heapscan) noexcept {
+			auto const nDecibitsEntropy = int(heapscan.m_bytehistogram.Entropy() * 10 + 0.5);
+			tc::append(tc::cout(), "\t", strName, ": ", AsMegabytes(heapscan.m_cbScanned),
+				", ", tc::as_dec(0 == heapscan.m_cbScanned ? 0 : heapscan.m_cbZeroPages * 100 / heapscan.m_cbScanned), "% zero pages",
+				", ", tc::as_dec(nDecibitsEntropy / 10), ".", tc::as_dec(nDecibitsEntropy % 10), " bits per byte in the other pages\n"
+			);
+		};
+		tc::append(tc::cout(), "Dumped malloc regions\n");
+		tc::for_each(mapntagheapscan, [&](auto const& pairntagheapscan) noexcept {
+			PrintHeapScan(UserTagString(pairntagheapscan.first), pairntagheapscan.second);
+		});
+		PrintHeapScan("all", heapscanAll);
+		tc::append(tc::cout(), "\tscanned in ", tc::as_dec(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - tpStart).count()), "ms on ", tc::as_dec(nThreads), " threads\n");
+	}
+}
+
+int main(int argc, char *argv[]) noexcept { ENTRY
+	if(argc<2 || 3<argc) {
+		tc::append(tc::cerr(), "Syntax: memreport <dump file or unzipped minidump.dmp> [<number of threads>]\n");
+		return EXIT_FAILURE;
+	}
+	unsigned int const nThreads = 3 == argc ? std::max(1, std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+	try {
+		Report(argv[1], nThreads); // THROW(tc::file_failure, ExLoadFail)
+		return EXIT_SUCCESS;
+	} catch(tc::file_failure const&) {
+		tc::append(tc::cerr(), "[FAILURE] Could not read ", argv[1], ".\n");
+	} catch(ExLoadFail const&) {
+		tc::append(tc::cerr(), "[FAILURE] ", argv[1], " is not a dump file.\n");
+	}
+	return EXIT_FAILURE;
+EXIT }
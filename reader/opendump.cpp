@@ -44,6 +44,14 @@ int main(int argc, char *argv[]) noexcept { ENTRY
 	
 	try {
 		SDebugger debugger(SFileMapping(argv[1]), /*bMountSource*/ true); // THROW(ExLoadFail);
+		{
+			// Shows how well prewarmsymbols predicted the modules of this dump
+			auto const& symbolcachestats = debugger.m_symbolcachestats;
+			tc::append(tc::cout(), "Symbol cache: ",
+				tc::as_dec(symbolcachestats.m_nFilesCached), " of ", tc::as_dec(symbolcachestats.m_nFilesCached + symbolcachestats.m_nFilesCopied), " files were cached, ",
+				tc::as_dec(symbolcachestats.m_cbCopied / (1024 * 1024)), "MB copied\n"
+			);
+		}
 		RETURNS_VOID(debugger.m_debugger.SetInputFileHandle(stdin, false));
 		RETURNS_VOID(debugger.m_debugger.SetOutputFileHandle(stdout, false));
 		RETURNS_VOID(debugger.m_debugger.SetErrorFileHandle(stderr, false));
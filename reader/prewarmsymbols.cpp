@@ -0,0 +1,130 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "tc/range.h"
+
+#include "DumpCatalog.h"
+#include "SymbolCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// Copies the binaries and symbol files of the modules in recent dumps into the local symbol cache before anybody opens
+// these dumps, so opendump does not have to wait for the server. A new build or a macOS update brings many dumps with
+// the same modules, so the modules seen most often in recent dumps are copied first.
+// Run it periodically after `dumpcatalog update`, e.g., from launchd. It shares the cache with opendump, see SSymbolCache.
+
+namespace {
+	constexpr auto c_durLookback = std::chrono::hours(14 * 24); // older dumps are not considered
+	constexpr double c_dSecondsHalfLife = 24 * 60 * 60; // a dump from yesterday counts half as much as a dump from now
+
+	// Spaces out copies so that all threads together copy at most m_cbPerSecond on average
+	struct SBandwidthLimit final {
+		explicit SBandwidthLimit(std::uint64_t cbPerSecond) noexcept
+			: m_cbPerSecond(cbPerSecond)
+		{}
+
+		void Wait(std::uint64_t cbCopied) & noexcept {
+			if(0 == m_cbPerSecond || 0 == cbCopied) {
+				return;
+			}
+			std::chrono::steady_clock::time_point tpWait;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_tpAvailable = std::max(m_tpAvailable, std::chrono::steady_clock::now())
+					+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(double(cbCopied) / m_cbPerSecond));
+				tpWait = m_tpAvailable;
+			}
+			std::this_thread::sleep_until(tpWait);
+		}
+
+	private:
+		std::uint64_t const m_cbPerSecond; // 0 means unlimited
+		std::mutex m_mutex;
+		std::chrono::steady_clock::time_point m_tpAvailable;
+	};
+}
+
+int main(int argc, char *argv[]) noexcept { ENTRY
+	if(argc<3 || 5<argc) {
+		tc::append(tc::cerr(), "Syntax: prewarmsymbols <uuid index folder> <dump catalog file> [<number of concurrent copies> [<MB per second>]]\n");
+		return EXIT_FAILURE;
+	}
+	auto const strUuidsPath = tc::make_str(argv[1], "/");
+	unsigned int const nThreads = 4 <= argc ? std::max(1, std::atoi(argv[3])) : 4;
+	SBandwidthLimit bandwidthlimit(5 <= argc ? std::uint64_t(std::max(0, std::atoi(argv[4]))) * 1024 * 1024 : 0);
+
+	SDumpCatalog catalog;
+	try {
+		catalog = SDumpCatalog::Load(argv[2]); // THROW(tc::file_failure, ExLoadFail)
+	} catch(tc::file_failure const&) {
+		tc::append(tc::cerr(), "[FAILURE] Could not read ", argv[2], ".\n");
+		return EXIT_FAILURE;
+	} catch(ExLoadFail const&) {
+		tc::append(tc::cerr(), "[FAILURE] ", argv[2], " is not a dump catalog.\n");
+		return EXIT_FAILURE;
+	}
+
+	// Rank the modules of recent dumps by frequency and recency. Each dump adds a weight that halves every c_dSecondsHalfLife.
+	auto const nNow = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	auto const nLookback = std::chrono::duration_cast<std::chrono::seconds>(c_durLookback).count();
+	std::unordered_map<std::basic_string<char>, double> mapstrdScore;
+	tc::for_each(tc::iota(std::size_t(0), tc::size(catalog.m_modules)), [&](std::size_t iModule) noexcept {
+		auto const nAge = std::max<std::int64_t>(0, nNow - catalog.m_dumps.m_vecnModificationTime[catalog.m_modules.m_veciDump[iModule]]);
+		auto const strUuid = catalog.m_modules.m_colstrUuid[iModule];
+		if(nAge < nLookback && 36 == tc::size(strUuid)) {
+			mapstrdScore[tc::make_str(strUuid)] += std::exp2(-nAge / c_dSecondsHalfLife);
+		}
+	});
+	auto vecpairstrdScore = tc::make_vector(tc::transform(mapstrdScore, [](auto const& pairstrdScore) noexcept {
+		return std::make_pair(pairstrdScore.first, pairstrdScore.second);
+	}));
+	std::sort(tc::begin(vecpairstrdScore), tc::end(vecpairstrdScore), [](auto const& pairLhs, auto const& pairRhs) noexcept {
+		return pairRhs.second < pairLhs.second;
+	});
+
+	// Each thread has its own SSymbolCache because SSymbolCache keeps opened dyld shared caches
+	tc::vector<SSymbolCache::SStatistics> vecsymbolcachestats(nThreads);
+	std::atomic<std::size_t> iUuidNext(0);
+	auto Prewarm = [&](unsigned int iThread) noexcept {
+		SSymbolCache symbolcache(strUuidsPath);
+		for(std::size_t iUuid = iUuidNext++; iUuid < tc::size(vecpairstrdScore); iUuid = iUuidNext++) {
+			auto const cbCopiedBefore = symbolcache.m_stats.m_cbCopied;
+			symbolcache.LookupBinaryAndSymbol(vecpairstrdScore[iUuid].first, /*bMountSource*/ false);
+			bandwidthlimit.Wait(symbolcache.m_stats.m_cbCopied - cbCopiedBefore);
+		}
+		vecsymbolcachestats[iThread] = symbolcache.m_stats;
+	};
+	{
+		tc::vector<std::thread> vecthread;
+		tc::for_each(tc::iota(1u, nThreads), [&](unsigned int iThread) noexcept {
+			tc::cont_emplace_back(vecthread, Prewarm, iThread);
+		});
+		Prewarm(0);
+		tc::for_each(vecthread, [](std::thread& thread) noexcept { thread.join(); });
+	}
+
+	// Files that were cached already are what opendump would have found on first open without this run
+	SSymbolCache::SStatistics symbolcachestats;
+	tc::for_each(vecsymbolcachestats, [&](SSymbolCache::SStatistics const& symbolcachestatsThread) noexcept {
+		symbolcachestats.m_nFilesCached += symbolcachestatsThread.m_nFilesCached;
+		symbolcachestats.m_nFilesCopied += symbolcachestatsThread.m_nFilesCopied;
+		symbolcachestats.m_cbCopied += symbolcachestatsThread.m_cbCopied;
+	});
+	auto const nFiles = symbolcachestats.m_nFilesCached + symbolcachestats.m_nFilesCopied;
+	tc::append(tc::cout(),
+		tc::as_dec(tc::size(vecpairstrdScore)), " modules in recent dumps, ",
+		tc::as_dec(symbolcachestats.m_nFilesCached), " of ", tc::as_dec(nFiles), " files were cached",
+		0 == nFiles ? tc::make_str("") : tc::make_str(" (", tc::as_dec(symbolcachestats.m_nFilesCached * 100 / nFiles), "%)"),
+		", ", tc::as_dec(symbolcachestats.m_nFilesCopied), " files copied, ", tc::as_dec(symbolcachestats.m_cbCopied / (1024 * 1024)), "MB\n"
+	);
+	return EXIT_SUCCESS;
+EXIT }
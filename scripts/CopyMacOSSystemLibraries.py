@@ -51,10 +51,8 @@ if __name__ == "__main__":
 		for strArch in os.listdir(strDyldCache):
 			strArchLocalFile = os.path.join(strDyldCache, strArch)
 			assert strArch.startswith("dyld_shared_cache") or strArch.startswith("aot_shared_cache") 
+			# Copy the main cache and its sub caches unchanged. indexdyldcache adds their images to the uuid index
+			# and the reader extracts single images on demand.
 			if strArch.startswith("dyld_shared_cache") and os.path.isfile(strArchLocalFile) and not strArch.endswith(".map"):
 				print(strArchLocalFile)
-				
-				strArchTargetDir = os.path.join(strTargetDyldCache, strArch)
-				os.mkdir(strArchTargetDir)
-				subprocess.check_call(["dyld_shared_cache_util", "-extract", strArchTargetDir, strArchLocalFile])
-			
+				shutil.copyfile(strArchLocalFile, os.path.join(strTargetDyldCache, strArch))
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "tc/range.h"
+#include "DumpPolicy.h"
 
 #include <mach/mach.h>
 #include <bootstrap.h>
@@ -34,6 +35,8 @@ private:
 
 public:
 	std::basic_string<char> WriteDump(bool bBig) const& THROW(tc::file_failure);
+	// dumppolicy is typically loaded once with SDumpPolicy::Load when the crash handler starts
+	std::basic_string<char> WriteDump(SDumpPolicy const& dumppolicy) const& THROW(tc::file_failure);
 	
 	template<typename Pipe>
 	static void Marshal(Pipe& pipe) MAYTHROW {
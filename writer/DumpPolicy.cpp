@@ -0,0 +1,129 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "DumpPolicy.h"
+#include "tc/range.h"
+
+#include <string_view>
+
+namespace {
+	// Splits str at any of the characters in szSeparators and skips empty tokens
+	tc::vector<std::string_view> Tokens(std::string_view str, char const* szSeparators) noexcept {
+		tc::vector<std::string_view> vecstr;
+		for(;;) {
+			auto const iBegin = str.find_first_not_of(szSeparators);
+			if(std::string_view::npos == iBegin) {
+				return vecstr;
+			}
+			str.remove_prefix(iBegin);
+			auto const iEnd = std::min(str.find_first_of(szSeparators), tc::size(str));
+			tc::cont_emplace_back(vecstr, str.substr(0, iEnd));
+			str.remove_prefix(iEnd);
+		}
+	}
+
+	// Decimal number with optional K, M or G suffix
+	std::optional<std::uint64_t> ParseSize(std::string_view str) noexcept {
+		std::uint64_t nFactor = 1;
+		if(!tc::empty(str)) {
+			switch(str.back()) {
+				case 'K': nFactor = std::uint64_t(1) << 10; break;
+				case 'M': nFactor = std::uint64_t(1) << 20; break;
+				case 'G': nFactor = std::uint64_t(1) << 30; break;
+			}
+			if(1 != nFactor) {
+				str.remove_suffix(1);
+			}
+		}
+		std::uint64_t n;
+		if(!boost::conversion::try_lexical_convert(str, n) || std::numeric_limits<std::uint64_t>::max() / nFactor < n) {
+			return std::nullopt;
+		}
+		return n * nFactor;
+	}
+
+	std::optional<vm_prot_t> ParseProtection(std::string_view str) noexcept {
+		vm_prot_t prot = VM_PROT_NONE;
+		for(char const ch : str) {
+			switch(ch) {
+				case 'r': prot |= VM_PROT_READ; break;
+				case 'w': prot |= VM_PROT_WRITE; break;
+				case 'x': prot |= VM_PROT_EXECUTE; break;
+				default: return std::nullopt;
+			}
+		}
+		return prot;
+	}
+}
+
+std::optional<SDumpPolicy> SDumpPolicy::Load(char const* szPath) noexcept {
+	std::basic_string<char> strPolicy;
+	try {
+		strPolicy = tc::make_str(tc::as_typed_range<char>(SFileMapping(szPath))); // THROW(tc::file_failure)
+	} catch(tc::file_failure const&) {
+		TRACE("Could not read dump policy ", szPath);
+		return std::nullopt;
+	}
+
+	SDumpPolicy dumppolicy;
+	for(auto const strLine : Tokens(strPolicy, "\r\n")) {
+		auto MalformedLine = [&]() noexcept {
+			TRACE("Malformed line in dump policy ", szPath, ": ", strLine);
+			return std::nullopt;
+		};
+		auto const vecstrToken = Tokens(strLine.substr(0, strLine.find('#')), " \t");
+		if(tc::empty(vecstrToken)) {
+			continue;
+		}
+
+		if("budget" == vecstrToken[0]) {
+			if(2 != tc::size(vecstrToken)) return MalformedLine();
+			auto const ocb = ParseSize(vecstrToken[1]);
+			if(!ocb) return MalformedLine();
+			dumppolicy.m_cbBudget = *ocb;
+		} else if("rule" == vecstrToken[0]) {
+			std::optional<int> onPriority;
+			SRule rule{0};
+			for(auto const strAssignment : tc::drop_first(vecstrToken)) {
+				auto const iEqual = strAssignment.find('=');
+				if(std::string_view::npos == iEqual) return MalformedLine();
+				auto const strKey = strAssignment.substr(0, iEqual);
+				auto const strValue = strAssignment.substr(iEqual + 1);
+
+				if("priority" == strKey) {
+					int nPriority;
+					if(!boost::conversion::try_lexical_convert(strValue, nPriority) || nPriority < 0) return MalformedLine();
+					onPriority = nPriority;
+				} else if("user_tag" == strKey) {
+					unsigned int nUserTag;
+					if(!boost::conversion::try_lexical_convert(strValue, nUserTag) || 255 < nUserTag) return MalformedLine();
+					rule.m_onUserTag = nUserTag;
+				} else if("share_mode" == strKey) {
+					unsigned int nShareMode;
+					if(!boost::conversion::try_lexical_convert(strValue, nShareMode) || 255 < nShareMode) return MalformedLine();
+					rule.m_onShareMode = tc::explicit_cast<unsigned char>(nShareMode);
+				} else if("prot" == strKey) {
+					auto const oprot = ParseProtection(strValue);
+					if(!oprot) return MalformedLine();
+					rule.m_protRequired = *oprot;
+				} else if("thread_distance" == strKey) {
+					auto const ocb = ParseSize(strValue);
+					if(!ocb) return MalformedLine();
+					rule.m_ocbThreadDistance = *ocb;
+				} else {
+					return MalformedLine();
+				}
+			}
+			if(!onPriority) return MalformedLine();
+			rule.m_nPriority = *onPriority;
+			tc::cont_emplace_back(dumppolicy.m_vecrule, tc_move(rule));
+		} else {
+			return MalformedLine();
+		}
+	}
+	return dumppolicy;
+}
@@ -0,0 +1,85 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+
+#include <mach/vm_prot.h>
+#include <mach/vm_region.h>
+#include <mach/vm_statistics.h>
+#include <mach/vm_types.h>
+
+// Decides which memory regions MiniDumpWriteDump sends with the dump. Each region gets the priority of the first
+// matching rule, or 0 if no rule matches. Regions with priority 0 are never sent. The others are sent in
+// order of decreasing priority as long as the sum of their sizes stays within m_cbBudget. The budget counts
+// the uncompressed bytes of the core file, not the size of the compressed dump. Regions that are not sent
+// are still listed as unmapped segments.
+struct SDumpPolicy final {
+	struct SRule final {
+		int m_nPriority;
+		std::optional<unsigned int> m_onUserTag; // see VM_MEMORY_XXX in <mach/vm_statistics.h>
+		std::optional<unsigned char> m_onShareMode; // see SM_XXX in <mach/vm_region.h>
+		vm_prot_t m_protRequired = VM_PROT_NONE; // all of these protection bits must be set
+		std::optional<mach_vm_size_t> m_ocbThreadDistance; // rsp or rbp of some thread lies in the region extended by this many bytes in both directions
+
+		template<typename RngThreadPointer>
+		bool Matches(mach_vm_address_t pvBegin, mach_vm_size_t cb, vm_prot_t prot, unsigned int nUserTag, unsigned char nShareMode, RngThreadPointer const& rngpvThread) const& noexcept {
+			return (!m_onUserTag || *m_onUserTag==nUserTag)
+				&& (!m_onShareMode || *m_onShareMode==nShareMode)
+				&& m_protRequired==(prot&m_protRequired)
+				&& (!m_ocbThreadDistance || tc::any_of(rngpvThread, [&](mach_vm_address_t pvThread) noexcept {
+					// Compares distances instead of extending the region, which could wrap around for large distances
+					if(pvThread < pvBegin) {
+						return pvBegin - pvThread <= *m_ocbThreadDistance;
+					} else {
+						return pvThread - pvBegin < cb || pvThread - pvBegin - cb < *m_ocbThreadDistance;
+					}
+				}));
+		}
+	};
+
+	tc::vector<SRule> m_vecrule;
+	std::uint64_t m_cbBudget = std::numeric_limits<std::uint64_t>::max(); // uncompressed bytes of memory content in the core file
+
+	// Stacks and the regions rsp and rbp point into
+	static SDumpPolicy Small() noexcept {
+		SDumpPolicy dumppolicy;
+		tc::cont_emplace_back(dumppolicy.m_vecrule, SRule{100, std::nullopt, std::nullopt, VM_PROT_NONE, 0});
+		tc::cont_emplace_back(dumppolicy.m_vecrule, SRule{90, VM_MEMORY_STACK});
+		return dumppolicy;
+	}
+
+	// Everything readable
+	static SDumpPolicy Big() noexcept {
+		auto dumppolicy = Small();
+		tc::cont_emplace_back(dumppolicy.m_vecrule, SRule{10});
+		return dumppolicy;
+	}
+
+	// Reads a policy file, e.g.,
+	//
+	//	# comment
+	//	budget 256M
+	//	rule priority=100 thread_distance=0
+	//	rule priority=90 user_tag=30
+	//	rule priority=50 user_tag=1 prot=rw thread_distance=1M
+	//	rule priority=10 share_mode=1
+	//
+	// Returns std::nullopt if the file cannot be read or is malformed.
+	static std::optional<SDumpPolicy> Load(char const* szPath) noexcept;
+
+	template<typename RngThreadPointer>
+	int Priority(mach_vm_address_t pvBegin, mach_vm_size_t cb, vm_prot_t prot, unsigned int nUserTag, unsigned char nShareMode, RngThreadPointer const& rngpvThread) const& noexcept {
+		for(auto const& rule : m_vecrule) {
+			if(rule.Matches(pvBegin, cb, prot, nUserTag, nShareMode, rngpvThread)) {
+				return rule.m_nPriority;
+			}
+		}
+		return 0;
+	}
+};
@@ -0,0 +1,63 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "tc/range.h"
+
+#include <array>
+#include <chrono>
+
+// Instrumentation of MiniDumpWriteDump. Every dump carries its own SDumpStatistics in the
+// metadata prefix, so the backend can aggregate them over many dumps to find slow phases.
+struct SDumpStatistics final {
+	// Monotonic duration of each phase
+	std::uint64_t m_nNanosecondsSuspend = 0;
+	std::uint64_t m_nNanosecondsThreads = 0;
+	std::uint64_t m_nNanosecondsDyldInfo = 0;
+	std::uint64_t m_nNanosecondsModules = 0;
+	std::uint64_t m_nNanosecondsRegions = 0;
+	std::uint64_t m_nNanosecondsSegments = 0; // written after the fact, see MiniDumpWriteDump
+
+	// Regions reported by mach_vm_region_recurse, excluding submaps
+	std::uint64_t m_nRegions = 0;
+	std::uint64_t m_nRegionsMapped = 0; // without failed remaps, written after the fact like m_nNanosecondsSegments, as are m_cbMapped, m_cbUnmapped and m_acbMappedByUserTag
+	std::uint64_t m_nRegionsSkipped = 0; // IO memory and unreadable regions
+	std::uint64_t m_cbMapped = 0;
+	std::uint64_t m_cbUnmapped = 0;
+	std::uint64_t m_nRegionsOverBudget = 0; // would have been mapped if SDumpPolicy::m_cbBudget had allowed it
+	std::uint64_t m_cbOverBudget = 0;
+	std::uint64_t m_nRegionsRemapFailed = 0; // mapped, but could not be remapped to be written; written after the fact like m_nNanosecondsSegments
+
+	// Indexed by user_tag, see VM_MEMORY_XXX in <mach/vm_statistics.h>. user_tag is 8 bits wide.
+	std::array<std::uint64_t, 256> m_acbByUserTag = {};
+	std::array<std::uint64_t, 256> m_acbMappedByUserTag = {};
+
+	// Number of mach calls into the dumped task
+	std::uint64_t m_nCallsTaskThreads = 0;
+	std::uint64_t m_nCallsThreadInfo = 0;
+	std::uint64_t m_nCallsThreadGetState = 0;
+	std::uint64_t m_nCallsTaskInfo = 0;
+	std::uint64_t m_nCallsVmReadOverwrite = 0;
+	std::uint64_t m_nCallsVmRegion = 0;
+	std::uint64_t m_nCallsVmRegionRecurse = 0;
+	std::uint64_t m_nCallsVmRemap = 0;
+
+	static void AddElapsed(std::uint64_t& nNanoseconds, std::chrono::steady_clock::time_point tpStart) noexcept {
+		nNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tpStart).count();
+	}
+};
+
+// Decimal with leading zeros. The field has a fixed width so it can be overwritten in place once its value is known.
+inline std::array<char, 20> AsFixedWidthDec(std::uint64_t n) noexcept {
+	std::array<char, 20> ach;
+	for(auto it = ach.rbegin(); it != ach.rend(); ++it) {
+		*it = '0' + n % 10;
+		n /= 10;
+	}
+	return ach;
+}
@@ -0,0 +1,124 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "MinidumpWriter.h"
+#include "tc/range.h"
+
+#include <mach/mach_vm.h>
+#include <servers/bootstrap.h>
+#include <sys/semaphore.h>
+
+// Task backend of MiniDumpWriteDump for a live task, see MinidumpWriter.h
+struct SMachTask final {
+	explicit SMachTask(task_t task) noexcept
+		: m_task(task)
+	{}
+
+	void Suspend() const& noexcept {
+		MACHERR(task_suspend(m_task));
+	}
+
+	void Resume() const& noexcept {
+		MACHERR(task_resume(m_task));
+	}
+
+	tc::vector<STaskThread> Threads(SDumpStatistics& dumpstats) const& noexcept {
+		mach_msg_type_number_t cThreads;
+		thread_array_t athread;
+
+		++dumpstats.m_nCallsTaskThreads;
+		MACHERR(task_threads(m_task, &athread, &cThreads));
+		scope_exit(
+			tc::for_each(tc::iota(0u, cThreads), [&](int iThread) noexcept {
+				MACHERR(mach_port_deallocate(mach_task_self(), athread[iThread]));
+			});
+
+			MACHERR(mach_vm_deallocate(mach_task_self(), reinterpret_cast<mach_vm_address_t>(athread), cThreads * sizeof(thread_act_t)));
+		);
+
+		return tc::make_vector(
+			tc::transform(
+				tc::iota(0u, cThreads),
+				[&](int iThread) noexcept {
+					STaskThread thread;
+
+					thread_identifier_info threadidinfo;
+					mach_msg_type_number_t cnInfo = THREAD_IDENTIFIER_INFO_COUNT;
+					++dumpstats.m_nCallsThreadInfo;
+					MACHERR(thread_info(athread[iThread], THREAD_IDENTIFIER_INFO, reinterpret_cast<thread_info_t>(std::addressof(threadidinfo)), std::addressof(cnInfo)));
+					thread.m_threadid = threadidinfo.thread_id;
+
+					auto GetThreadState = [&](thread_state_flavor_t flavor, mach_msg_type_number_t cnThreadState, auto& threadstate) noexcept {
+						mach_msg_type_number_t cbThreadState = cnThreadState;
+						++dumpstats.m_nCallsThreadGetState;
+						MACHERR(thread_get_state(athread[iThread], flavor, reinterpret_cast<thread_state_t>(std::addressof(threadstate)), std::addressof(cbThreadState)));
+						_ASSERTEQUAL(cbThreadState, cnThreadState);
+					};
+
+					GetThreadState(x86_THREAD_STATE64, x86_THREAD_STATE64_COUNT, thread.m_threadstate);
+					GetThreadState(x86_FLOAT_STATE64, x86_FLOAT_STATE64_COUNT, thread.m_floatstate);
+					GetThreadState(x86_EXCEPTION_STATE64, x86_EXCEPTION_STATE64_COUNT, thread.m_exceptionstate);
+
+					return thread;
+				}
+			)
+		);
+	}
+
+	task_dyld_info DyldInfo() const& noexcept {
+		task_dyld_info dyldinfo;
+		mach_msg_type_number_t cnDyldInfo = TASK_DYLD_INFO_COUNT;
+		MACHERR(task_info(m_task, TASK_DYLD_INFO, reinterpret_cast<task_info_t>(std::addressof(dyldinfo)), &cnDyldInfo));
+		return dyldinfo;
+	}
+
+	void ReadMemory(mach_vm_address_t pv, tc::ptr_range<unsigned char> rngbyte) const& noexcept {
+		mach_vm_size_t cbActual = 0;
+		MACHERR(mach_vm_read_overwrite(m_task, pv, tc::size(rngbyte), reinterpret_cast<mach_vm_address_t>(tc::ptr_begin(rngbyte)), std::addressof(cbActual)));
+		_ASSERTEQUAL(cbActual, tc::size(rngbyte));
+	}
+
+	bool RegionRecurse(mach_vm_address_t& pv, mach_vm_size_t& cb, natural_t& nDepth, vm_region_submap_info_64& vmregioninfo) const& noexcept {
+		mach_msg_type_number_t cbVMRegionInfo = VM_REGION_SUBMAP_INFO_COUNT_64;
+		return KERN_SUCCESS == MACHERRIGNORE(
+			mach_vm_region_recurse(
+				m_task,
+				std::addressof(pv),
+				std::addressof(cb),
+				std::addressof(nDepth),
+				reinterpret_cast<vm_region_info_64_t>(std::addressof(vmregioninfo)),
+				std::addressof(cbVMRegionInfo)
+			),
+			(KERN_INVALID_ADDRESS)
+		);
+	}
+
+	void RegionBasic(mach_vm_address_t& pv, mach_vm_size_t& cb) const& noexcept {
+		vm_region_basic_info_64 regionbasicinfo;
+		mach_msg_type_number_t cnInfo = VM_REGION_BASIC_INFO_COUNT_64;
+		mach_port_t portObject = 0;
+		MACHERR(mach_vm_region(m_task, std::addressof(pv), std::addressof(cb), VM_REGION_BASIC_INFO_64, reinterpret_cast<vm_region_info_t>(std::addressof(regionbasicinfo)), std::addressof(cnInfo), std::addressof(portObject)));
+	}
+
+	template<typename Func>
+	bool ForRemappedRegion(mach_vm_address_t pv, mach_vm_size_t cb, Func fn) const& MAYTHROW {
+		mach_vm_address_t pvRegionNew = 0;
+		vm_prot_t protCur = VM_PROT_NONE;
+		vm_prot_t protMax = VM_PROT_NONE;
+		if(KERN_SUCCESS==MACHERRIGNORE(mach_vm_remap(mach_task_self(), std::addressof(pvRegionNew), cb, 0, VM_FLAGS_ANYWHERE, m_task, pv, false, std::addressof(protCur), std::addressof(protMax), VM_INHERIT_NONE), (KERN_NO_SPACE))) {
+			scope_exit(MACHERR(mach_vm_deallocate(mach_task_self(), pvRegionNew, cb)));
+			fn(reinterpret_cast<unsigned char const*>(pvRegionNew)); // MAYTHROW
+			return true;
+		}
+		return false;
+	}
+
+private:
+	task_t m_task;
+};
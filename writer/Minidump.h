@@ -9,5 +9,7 @@
 #pragma once
 
 #include "tc/range.h"
+#include "DumpPolicy.h"
 #include <mach/mach_types.h>
+std::basic_string<char> MiniDumpWriteDump(task_t task, std::uint64_t threadid, SDumpPolicy const& dumppolicy, tc::ptr_range<char const> strExecutable, tc::ptr_range<tc::char16 const> strBundleVersion) THROW(tc::file_failure);
 std::basic_string<char> MiniDumpWriteDump(task_t task, std::uint64_t threadid, bool bBig, tc::ptr_range<char const> strExecutable, tc::ptr_range<tc::char16 const> strBundleVersion) THROW(tc::file_failure);
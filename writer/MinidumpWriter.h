@@ -0,0 +1,483 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "DumpPolicy.h"
+#include "DumpStatistics.h"
+#include "tc/range.h"
+#include "tc/append.h"
+
+#include <mach-o/loader.h>
+#include <mach-o/dyld_images.h>
+#include <mach/task_info.h>
+#include <mach/thread_status.h>
+#include <mach/vm_param.h>
+#include <mach/vm_region.h>
+#include <mach/vm_statistics.h>
+
+// MiniDumpWriteDump accesses the dumped task only through a task backend. SMachTask in Minidump.cpp
+// calls the Mach APIs, SReplayTask in ReplayTask.h replays an address space, e.g., for benchmarks on Linux.
+// A task backend has the members
+//
+//	void Suspend();
+//	void Resume();
+//	tc::vector<STaskThread> Threads(SDumpStatistics& dumpstats); // counts its calls into the task in dumpstats
+//	task_dyld_info DyldInfo();
+//	void ReadMemory(mach_vm_address_t pv, tc::ptr_range<unsigned char> rngbyte);
+//	bool RegionRecurse(mach_vm_address_t& pv, mach_vm_size_t& cb, natural_t& nDepth, vm_region_submap_info_64& vmregioninfo); // like mach_vm_region_recurse, false past the last region
+//	void RegionBasic(mach_vm_address_t& pv, mach_vm_size_t& cb); // like mach_vm_region
+//	bool ForRemappedRegion(mach_vm_address_t pv, mach_vm_size_t cb, Func fn); // calls fn(unsigned char const*) with a local copy of the region, false if there was no address space left
+
+struct STaskThread final {
+	std::uint64_t m_threadid; // as returned by mach thread_info system call
+	x86_thread_state64_t m_threadstate;
+	x86_float_state64_t m_floatstate;
+	x86_exception_state64_t m_exceptionstate;
+};
+
+template<std::uint32_t nCOMMAND, typename TCommand, typename Func>
+tc::break_or_continue ForEachLoadCommand(mach_header_64 const* pmachheader, Func fn) MAYTHROW {
+	_ASSERTEQUAL(pmachheader->magic, MH_MAGIC_64);
+	auto rngbyteLoadCommand = tc::counted(
+		reinterpret_cast<unsigned char const*>(pmachheader) + sizeof(mach_header_64),
+		pmachheader->sizeofcmds
+	);
+	for (auto itbyteLoadCommand = tc::begin(rngbyteLoadCommand);
+		itbyteLoadCommand != tc::end(rngbyteLoadCommand);
+		itbyteLoadCommand += reinterpret_cast<load_command const*>(itbyteLoadCommand)->cmdsize) // TODO: parallel_for_each segment
+	{
+		if (nCOMMAND == reinterpret_cast<load_command const*>(itbyteLoadCommand)->cmd) {
+			RETURN_IF_BREAK(tc::continue_if_not_break(fn, *reinterpret_cast<TCommand const*>(itbyteLoadCommand))); // MAYTHROW
+		}
+	}
+	return tc::continue_;
+}
+
+template<typename Task, typename Func>
+tc::break_or_continue ForEachMemoryRegion(Task& task, mach_vm_address_t pvBegin, SDumpStatistics& dumpstats, Func fn) noexcept {
+	mach_vm_size_t cb = 0;
+
+	vm_region_submap_info_64 vmregioninfo;
+	natural_t nDepth = 0;
+
+	while(++dumpstats.m_nCallsVmRegionRecurse, task.RegionRecurse(pvBegin, cb, nDepth, vmregioninfo)) {
+		if(vmregioninfo.is_submap) {
+			++nDepth;
+		} else {
+			++dumpstats.m_nRegions;
+			// See https://opensource.apple.com/source/system_cmds/system_cmds-735.50.6/gcore.tproj/vanilla.c.auto.html
+			if(VM_MEMORY_IOKIT != vmregioninfo.user_tag  // skip IO memory segments
+			&& VM_PROT_READ==(vmregioninfo.protection&VM_PROT_READ)) { // unreadable segments
+				dumpstats.m_acbByUserTag[vmregioninfo.user_tag] += cb;
+				TRACE("vmregion: ",
+					tc::as_padded_lc_hex(pvBegin), " ",
+					tc::as_dec(vmregioninfo.protection), ", ",
+					tc::as_dec(vmregioninfo.user_tag), ", " // see <mach/vm_statistics.h>
+					, tc::as_dec(vmregioninfo.share_mode), ", " // see SM_XXX in <mach/vm_region.h>
+					, tc::as_dec(vmregioninfo.behavior)); // <mach/vm_behavior.h>
+				RETURN_IF_BREAK( tc::continue_if_not_break(fn, pvBegin, cb, vmregioninfo.protection, vmregioninfo.max_protection, vmregioninfo.user_tag, vmregioninfo.share_mode) );
+			} else {
+				++dumpstats.m_nRegionsSkipped;
+			}
+			pvBegin += cb;
+		}
+	}
+	return tc::continue_;
+}
+
+
+template<typename Task>
+std::basic_string<char> MiniDumpWriteDump(Task& task, std::uint64_t threadid, SDumpPolicy const& dumppolicy, tc::ptr_range<char const> strExecutable, tc::ptr_range<tc::char16 const> strBundleVersion) THROW(tc::file_failure) {
+	SDumpStatistics dumpstats;
+
+	auto tpStart = std::chrono::steady_clock::now();
+	task.Suspend();
+	scope_exit(task.Resume());
+	SDumpStatistics::AddElapsed(dumpstats.m_nNanosecondsSuspend, tpStart);
+
+	struct SThreadCommand {
+		thread_command m_header;
+		x86_thread_state m_threadstate;
+		x86_float_state m_floatstate;
+		x86_exception_state m_exceptionstate;
+	};
+
+	int iCurrentThread;
+	tpStart = std::chrono::steady_clock::now();
+	tc::vector<SThreadCommand> const vecthreadcmd = [&]() noexcept {
+		auto const vecthread = task.Threads(dumpstats);
+
+		return tc::make_vector(
+			tc::transform(
+				tc::iota(std::size_t(0), tc::size(vecthread)),
+				[&](std::size_t iThread) noexcept {
+					auto const& thread = vecthread[iThread];
+					if(thread.m_threadid==threadid) {
+						iCurrentThread = tc::explicit_cast<int>(iThread);
+					}
+
+					SThreadCommand threadcmd = {
+						{LC_THREAD, sizeof(SThreadCommand) },
+						{{x86_THREAD_STATE64, x86_THREAD_STATE64_COUNT}},
+						{{x86_FLOAT_STATE64, x86_FLOAT_STATE64_COUNT}},
+						{{x86_EXCEPTION_STATE64, x86_EXCEPTION_STATE64_COUNT}}
+					};
+					threadcmd.m_threadstate.uts.ts64 = thread.m_threadstate;
+					threadcmd.m_floatstate.ufs.fs64 = thread.m_floatstate;
+					threadcmd.m_exceptionstate.ues.es64 = thread.m_exceptionstate;
+					return threadcmd;
+				}
+			)
+		);
+	}();
+	_ASSERTINITIALIZED(iCurrentThread); // threadid must be one of the threads of the task
+	SDumpStatistics::AddElapsed(dumpstats.m_nNanosecondsThreads, tpStart);
+
+	// Enumerate regions before writing the metadata so the metadata can include the region statistics
+	tpStart = std::chrono::steady_clock::now();
+	tc::vector<mach_vm_address_t> vecpvThread;
+	tc::for_each(vecthreadcmd, [&](SThreadCommand const& threadcmd) noexcept {
+		tc::cont_emplace_back(vecpvThread, threadcmd.m_threadstate.uts.ts64.__rbp);
+		tc::cont_emplace_back(vecpvThread, threadcmd.m_threadstate.uts.ts64.__rsp);
+	});
+
+	struct SRegion final {
+		segment_command_64 m_segcmd;
+		unsigned int m_nUserTag;
+		unsigned char m_nShareMode;
+		int m_nPriority;
+		bool m_bMapped;
+	};
+	tc::vector<SRegion> vecregion;
+	ForEachMemoryRegion(task, MACH_VM_MIN_ADDRESS, dumpstats, [&](mach_vm_address_t pvBegin, mach_vm_size_t cb, vm_prot_t prot, vm_prot_t protMax, unsigned int nUserTag, unsigned char nShareMode) noexcept {
+		tc::cont_emplace_back(vecregion, SRegion{
+			segment_command_64 {
+				LC_SEGMENT_64,
+				sizeof(segment_command_64),
+				{0}, // segname[16]
+				pvBegin,
+				cb,
+				0, // file offset needs to be set once number of segments has been determined
+				0, // file size is set once we know whether the region fits into the budget
+				protMax,
+				prot,
+				0, // nsects
+				0 // flags
+			},
+			nUserTag,
+			nShareMode,
+			dumppolicy.Priority(pvBegin, cb, prot, nUserTag, nShareMode, vecpvThread),
+			false
+		});
+	});
+
+	{
+		// Fill the budget greedily in order of decreasing priority. Regions of equal priority are taken in address order.
+		auto vecpregion = tc::make_vector(tc::transform(
+			tc::filter(vecregion, [](SRegion const& region) noexcept { return 0 < region.m_nPriority; }),
+			[](SRegion& region) noexcept { return std::addressof(region); }
+		));
+		std::stable_sort(tc::begin(vecpregion), tc::end(vecpregion), [](SRegion const* pregionLhs, SRegion const* pregionRhs) noexcept {
+			return pregionRhs->m_nPriority < pregionLhs->m_nPriority;
+		});
+		auto cbBudget = dumppolicy.m_cbBudget;
+		tc::for_each(vecpregion, [&](SRegion* pregion) noexcept {
+			if(pregion->m_segcmd.vmsize <= cbBudget) {
+				cbBudget -= pregion->m_segcmd.vmsize;
+				pregion->m_bMapped = true;
+			} else {
+				++dumpstats.m_nRegionsOverBudget;
+				dumpstats.m_cbOverBudget += pregion->m_segcmd.vmsize;
+			}
+		});
+	}
+
+	tc::vector<segment_command_64> vecsegmentMapped; // memory content will be sent with dump
+	tc::vector<SRegion*> vecpregionMapped; // parallel to vecsegmentMapped
+	tc::vector<segment_command_64> vecsegmentUnmapped; // memory will not be sent
+	tc::for_each(vecregion, [&](SRegion& region) noexcept {
+		if(region.m_bMapped) {
+			tc::cont_emplace_back(vecpregionMapped, std::addressof(region));
+			++dumpstats.m_nRegionsMapped;
+			dumpstats.m_cbMapped += region.m_segcmd.vmsize;
+			dumpstats.m_acbMappedByUserTag[region.m_nUserTag] += region.m_segcmd.vmsize;
+			region.m_segcmd.filesize = region.m_segcmd.vmsize;
+			tc::cont_emplace_back(vecsegmentMapped, region.m_segcmd);
+		} else {
+			dumpstats.m_cbUnmapped += region.m_segcmd.vmsize;
+			tc::cont_emplace_back(vecsegmentUnmapped, region.m_segcmd);
+		}
+	});
+	// Each mapped segment is remapped exactly once when it is written
+	dumpstats.m_nCallsVmRemap = tc::size(vecsegmentMapped);
+	SDumpStatistics::AddElapsed(dumpstats.m_nNanosecondsRegions, tpStart);
+
+	std::basic_string<char> strFileDump;
+	scope_exit( tc::delete_file(tc::as_c_str(strFileDump)) );
+	{
+		tc::readwritefile fileDump;
+		tc::tie(fileDump, strFileDump) = tc::readwritefile::create_temporary(); // THROW(tc::file_failure)
+
+		// Write XML header
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+			"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+			"<root>"
+			"<version val=\"" BOOST_PP_STRINGIZE(c_nBuild) "\"/>"
+			"<PersistentType>"
+			"<m_strExecutable>", SXmlStringEscaper::Escape(strExecutable), "</m_strExecutable>"
+			"<m_strBundleVersion>", SXmlStringEscaper::Escape(strBundleVersion), "</m_strBundleVersion>"
+			"<m_nThread val=\"", tc::as_dec(iCurrentThread), "\"/>"); // THROW(tc::file_failure)
+
+		// Write list of loaded modules, their file path and start address
+		tpStart = std::chrono::steady_clock::now();
+		++dumpstats.m_nCallsTaskInfo;
+		task_dyld_info const dyldinfo = task.DyldInfo();
+		_ASSERTEQUAL(dyldinfo.all_image_info_format, TASK_DYLD_ALL_IMAGE_INFO_64);
+
+		auto ReadTaskMemory = [&](mach_vm_address_t pv, tc::ptr_range<unsigned char> rngbyte) noexcept {
+			++dumpstats.m_nCallsVmReadOverwrite;
+			task.ReadMemory(pv, rngbyte);
+		};
+
+		// Subset of dyld_all_image_infos. dyld_all_image_infos grows with macOS version updates. Extract only what we need.
+		struct dyld_all_image_infos_subset {
+			std::uint32_t version;
+			std::uint32_t infoArrayCount;
+			const struct dyld_image_info* infoArray;
+		};
+
+		dyld_all_image_infos_subset dyldallimginfos;
+		_ASSERT(sizeof(dyld_all_image_infos_subset) <= dyldinfo.all_image_info_size);
+		ReadTaskMemory(dyldinfo.all_image_info_addr, tc::as_blob(dyldallimginfos));
+
+		tc::vector<dyld_image_info> vecdyldimginfo;
+		vecdyldimginfo.resize(dyldallimginfos.infoArrayCount);
+		ReadTaskMemory(reinterpret_cast<mach_vm_address_t>(dyldallimginfos.infoArray), tc::range_as_blob(vecdyldimginfo));
+		SDumpStatistics::AddElapsed(dumpstats.m_nNanosecondsDyldInfo, tpStart);
+
+		tpStart = std::chrono::steady_clock::now();
+
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+			"<m_vecmodule length=\"", tc::as_dec(dyldallimginfos.infoArrayCount), "\">"); // THROW(tc::file_failure)
+		tc::for_each(
+			vecdyldimginfo,
+			[&](dyld_image_info const& dyldimginfo) noexcept {
+
+				tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+					"<elem>"
+					"<m_pvStartAddress val=\"", tc::as_dec(reinterpret_cast<std::uint64_t>(dyldimginfo.imageLoadAddress)), "\"/>"); // THROW(tc::file_failure)
+
+				{	// Map part of task's memory so we can read and print the zero-terminated file path
+					mach_vm_address_t pvRegion = reinterpret_cast<mach_vm_address_t>(dyldimginfo.imageFilePath);
+					mach_vm_size_t cb = 0;
+					++dumpstats.m_nCallsVmRegion;
+					task.RegionBasic(pvRegion, cb);
+
+					++dumpstats.m_nCallsVmRemap;
+					task.ForRemappedRegion(pvRegion, cb, [&](unsigned char const* pbRegionNew) noexcept {
+						tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+							"<m_strPath>", SXmlStringEscaper::Escape(reinterpret_cast<char const*>(pbRegionNew) + (reinterpret_cast<mach_vm_address_t>(dyldimginfo.imageFilePath) - pvRegion)), "</m_strPath>"); // THROW(tc::file_failure)
+					});
+				}
+
+				tc::vector<unsigned char> vecbyteModule(sizeof(mach_header_64));
+				ReadTaskMemory(reinterpret_cast<mach_vm_address_t>(dyldimginfo.imageLoadAddress), tc::range_as_blob(vecbyteModule));
+				vecbyteModule.resize(tc::size(vecbyteModule)+reinterpret_cast<mach_header_64 const*>(tc::ptr_begin(vecbyteModule))->sizeofcmds);
+
+				ReadTaskMemory(reinterpret_cast<mach_vm_address_t>(dyldimginfo.imageLoadAddress), tc::range_as_blob(vecbyteModule));
+
+				ForEachLoadCommand<LC_ID_DYLIB, dylib_command>(
+					reinterpret_cast<mach_header_64 const*>(tc::ptr_begin(vecbyteModule)),
+					[&](auto const& dylibcmd) noexcept {
+						tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+							"<m_modver val=\"", tc::as_dec(dylibcmd.dylib.current_version), "\"/>"); // THROW(tc::file_failure)
+						return INTEGRAL_CONSTANT(tc::break_)();
+					}
+				);
+
+				ForEachLoadCommand<LC_UUID, uuid_command>(
+					reinterpret_cast<mach_header_64 const*>(tc::ptr_begin(vecbyteModule)),
+					[&](auto const& uuidcmd) noexcept {
+						boost::uuids::uuid uuid;
+						STATICASSERTEQUAL(sizeof(uuid.data), sizeof(uuidcmd.uuid));
+						tc::cont_assign(uuid.data,uuidcmd.uuid);
+						tc::append(tc::make_typed_stream<XMLCHAR>(fileDump), "<m_uuid val=\"", tc::as_lc_hex(uuid), "\"/>"); // THROW(tc::file_failure)
+						return INTEGRAL_CONSTANT(tc::break_)();
+					}
+				);
+				tc::append(tc::make_typed_stream<XMLCHAR>(fileDump), "</elem>"); // THROW(tc::file_failure)
+			}
+		);
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileDump), "</m_vecmodule>"); // THROW(tc::file_failure)
+		SDumpStatistics::AddElapsed(dumpstats.m_nNanosecondsModules, tpStart);
+
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+			"<m_dumpstats>"
+			"<m_nNanosecondsSuspend val=\"", tc::as_dec(dumpstats.m_nNanosecondsSuspend), "\"/>"
+			"<m_nNanosecondsThreads val=\"", tc::as_dec(dumpstats.m_nNanosecondsThreads), "\"/>"
+			"<m_nNanosecondsDyldInfo val=\"", tc::as_dec(dumpstats.m_nNanosecondsDyldInfo), "\"/>"
+			"<m_nNanosecondsModules val=\"", tc::as_dec(dumpstats.m_nNanosecondsModules), "\"/>"
+			"<m_nNanosecondsRegions val=\"", tc::as_dec(dumpstats.m_nNanosecondsRegions), "\"/>"
+			"<m_nNanosecondsSegments val=\""); // THROW(tc::file_failure)
+		// Segments are written after the metadata. Reserve a fixed width field and fill it in afterwards.
+		auto const nOffsetNanosecondsSegments = fileDump.size(); // THROW(tc::file_failure)
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+			AsFixedWidthDec(0), "\"/>"
+			"<m_nRegionsRemapFailed val=\""); // THROW(tc::file_failure)
+		auto const nOffsetRegionsRemapFailed = fileDump.size(); // THROW(tc::file_failure)
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+			AsFixedWidthDec(0), "\"/>"
+			"<m_nRegions val=\"", tc::as_dec(dumpstats.m_nRegions), "\"/>"
+			"<m_nRegionsMapped val=\""); // THROW(tc::file_failure)
+		// Failed remaps move regions from mapped to unmapped, so these are filled in afterwards, too
+		auto const nOffsetRegionsMapped = fileDump.size(); // THROW(tc::file_failure)
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+			AsFixedWidthDec(dumpstats.m_nRegionsMapped), "\"/>"
+			"<m_nRegionsSkipped val=\"", tc::as_dec(dumpstats.m_nRegionsSkipped), "\"/>"
+			"<m_cbMapped val=\""); // THROW(tc::file_failure)
+		auto const nOffsetCbMapped = fileDump.size(); // THROW(tc::file_failure)
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+			AsFixedWidthDec(dumpstats.m_cbMapped), "\"/>"
+			"<m_cbUnmapped val=\""); // THROW(tc::file_failure)
+		auto const nOffsetCbUnmapped = fileDump.size(); // THROW(tc::file_failure)
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+			AsFixedWidthDec(dumpstats.m_cbUnmapped), "\"/>"
+			"<m_nRegionsOverBudget val=\"", tc::as_dec(dumpstats.m_nRegionsOverBudget), "\"/>"
+			"<m_cbOverBudget val=\"", tc::as_dec(dumpstats.m_cbOverBudget), "\"/>"
+			"<m_nCallsTaskThreads val=\"", tc::as_dec(dumpstats.m_nCallsTaskThreads), "\"/>"
+			"<m_nCallsThreadInfo val=\"", tc::as_dec(dumpstats.m_nCallsThreadInfo), "\"/>"
+			"<m_nCallsThreadGetState val=\"", tc::as_dec(dumpstats.m_nCallsThreadGetState), "\"/>"
+			"<m_nCallsTaskInfo val=\"", tc::as_dec(dumpstats.m_nCallsTaskInfo), "\"/>"
+			"<m_nCallsVmReadOverwrite val=\"", tc::as_dec(dumpstats.m_nCallsVmReadOverwrite), "\"/>"
+			"<m_nCallsVmRegion val=\"", tc::as_dec(dumpstats.m_nCallsVmRegion), "\"/>"
+			"<m_nCallsVmRegionRecurse val=\"", tc::as_dec(dumpstats.m_nCallsVmRegionRecurse), "\"/>"
+			"<m_nCallsVmRemap val=\"", tc::as_dec(dumpstats.m_nCallsVmRemap), "\"/>"
+			"<m_vecusertag length=\"", tc::as_dec(tc::count_if(dumpstats.m_acbByUserTag, [](std::uint64_t cb) noexcept { return 0 != cb; })), "\">"); // THROW(tc::file_failure)
+		std::array<decltype(fileDump.size()), 256> anOffsetCbMappedByUserTag = {}; // valid where m_acbByUserTag is not 0
+		tc::for_each(tc::iota(std::size_t(0), tc::size(dumpstats.m_acbByUserTag)), [&](std::size_t nUserTag) noexcept {
+			if(0 != dumpstats.m_acbByUserTag[nUserTag]) {
+				tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+					"<elem>"
+					"<m_nUserTag val=\"", tc::as_dec(nUserTag), "\"/>"
+					"<m_cb val=\"", tc::as_dec(dumpstats.m_acbByUserTag[nUserTag]), "\"/>"
+					"<m_cbMapped val=\""); // THROW(tc::file_failure)
+				anOffsetCbMappedByUserTag[nUserTag] = fileDump.size(); // THROW(tc::file_failure)
+				tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+					AsFixedWidthDec(dumpstats.m_acbMappedByUserTag[nUserTag]), "\"/>"
+					"</elem>"); // THROW(tc::file_failure)
+			}
+		});
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileDump),
+			"</m_vecusertag>"
+			"</m_dumpstats>"
+			"</PersistentType>"
+			"</root>"); // THROW(tc::file_failure)
+
+		mach_header_64 const header = {
+			MH_MAGIC_64,
+			CPU_TYPE_X86_64,
+			CPU_SUBTYPE_X86_64_ALL,
+			MH_CORE,
+			tc::size(vecsegmentMapped) + tc::size(vecsegmentUnmapped) + tc::size(vecthreadcmd),
+			tc::size(tc::range_as_blob(vecsegmentMapped)) + tc::size(tc::range_as_blob(vecsegmentUnmapped)) + tc::size(tc::range_as_blob(vecthreadcmd))
+		};
+
+		auto const cbDumpFileHeader = fileDump.size(); // THROW(tc::file_failure)
+		auto cbFileOffset = round_page(sizeof(mach_header_64) + header.sizeofcmds);
+		tc::for_each(vecsegmentMapped, [&](segment_command_64& segcmd) noexcept {
+			segcmd.fileoff = cbFileOffset;
+			cbFileOffset += segcmd.filesize;
+		});
+
+		tc::append(fileDump, tc::as_blob(header), tc::range_as_blob(vecsegmentMapped), tc::range_as_blob(vecsegmentUnmapped), tc::range_as_blob(vecthreadcmd));  // THROW(tc::file_failure)
+
+		{
+			tpStart = std::chrono::steady_clock::now();
+			tc::for_each(tc::iota(std::size_t(0), tc::size(vecsegmentMapped)), [&](std::size_t iSegment) noexcept {
+				auto& segcmd = vecsegmentMapped[iSegment];
+				fileDump.seek(cbDumpFileHeader + segcmd.fileoff);  // THROW(tc::file_failure)
+
+				if(!task.ForRemappedRegion(segcmd.vmaddr, segcmd.vmsize, [&](unsigned char const* pbRegionNew) noexcept {
+					tc::append(fileDump, tc::counted(pbRegionNew, segcmd.vmsize));
+				})) {
+					// No address space left to remap the region. Declare it as not dumped in its segment command,
+					// like the regions over budget, so the reader does not take the zeros in its part of the file for memory content.
+					TRACE("Could not remap region at ", tc::as_padded_lc_hex(segcmd.vmaddr), " of size ", tc::as_dec(segcmd.vmsize));
+					++dumpstats.m_nRegionsRemapFailed;
+					--dumpstats.m_nRegionsMapped;
+					dumpstats.m_cbMapped -= segcmd.vmsize;
+					dumpstats.m_cbUnmapped += segcmd.vmsize;
+					dumpstats.m_acbMappedByUserTag[vecpregionMapped[iSegment]->m_nUserTag] -= segcmd.vmsize;
+					vecpregionMapped[iSegment]->m_bMapped = false;
+					segcmd.fileoff = 0;
+					segcmd.filesize = 0;
+					fileDump.seek(cbDumpFileHeader + sizeof(mach_header_64) + iSegment * sizeof(segment_command_64)); // THROW(tc::file_failure)
+					tc::append(fileDump, tc::as_blob(segcmd)); // THROW(tc::file_failure)
+				}
+			});
+			SDumpStatistics::AddElapsed(dumpstats.m_nNanosecondsSegments, tpStart);
+
+			fileDump.seek(nOffsetNanosecondsSegments); // THROW(tc::file_failure)
+			tc::append(tc::make_typed_stream<XMLCHAR>(fileDump), AsFixedWidthDec(dumpstats.m_nNanosecondsSegments)); // THROW(tc::file_failure)
+			fileDump.seek(nOffsetRegionsRemapFailed); // THROW(tc::file_failure)
+			tc::append(tc::make_typed_stream<XMLCHAR>(fileDump), AsFixedWidthDec(dumpstats.m_nRegionsRemapFailed)); // THROW(tc::file_failure)
+			if(0 != dumpstats.m_nRegionsRemapFailed) {
+				fileDump.seek(nOffsetRegionsMapped); // THROW(tc::file_failure)
+				tc::append(tc::make_typed_stream<XMLCHAR>(fileDump), AsFixedWidthDec(dumpstats.m_nRegionsMapped)); // THROW(tc::file_failure)
+				fileDump.seek(nOffsetCbMapped); // THROW(tc::file_failure)
+				tc::append(tc::make_typed_stream<XMLCHAR>(fileDump), AsFixedWidthDec(dumpstats.m_cbMapped)); // THROW(tc::file_failure)
+				fileDump.seek(nOffsetCbUnmapped); // THROW(tc::file_failure)
+				tc::append(tc::make_typed_stream<XMLCHAR>(fileDump), AsFixedWidthDec(dumpstats.m_cbUnmapped)); // THROW(tc::file_failure)
+				tc::for_each(tc::iota(std::size_t(0), tc::size(dumpstats.m_acbByUserTag)), [&](std::size_t nUserTag) noexcept {
+					if(0 != dumpstats.m_acbByUserTag[nUserTag]) {
+						fileDump.seek(anOffsetCbMappedByUserTag[nUserTag]); // THROW(tc::file_failure)
+						tc::append(tc::make_typed_stream<XMLCHAR>(fileDump), AsFixedWidthDec(dumpstats.m_acbMappedByUserTag[nUserTag])); // THROW(tc::file_failure)
+					}
+				});
+			}
+		}
+	} // closes fileDump
+
+	// The core file only keeps address and protection of each region. Keep user_tag and share_mode for memory reports.
+	// A process has thousands of regions, so they go into their own zip entry instead of the metadata that tools like
+	// dumpcatalog inflate for every dump. They are written after the segments, so m_bMapped is false for failed remaps.
+	std::basic_string<char> strFileRegions;
+	scope_exit( tc::delete_file(tc::as_c_str(strFileRegions)) );
+	{
+		tc::readwritefile fileRegions;
+		tc::tie(fileRegions, strFileRegions) = tc::readwritefile::create_temporary(); // THROW(tc::file_failure)
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileRegions),
+			"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+			"<m_vecregion length=\"", tc::as_dec(tc::size(vecregion)), "\">"); // THROW(tc::file_failure)
+		tc::for_each(vecregion, [&](SRegion const& region) noexcept {
+			tc::append(tc::make_typed_stream<XMLCHAR>(fileRegions),
+				"<elem>"
+				"<m_pvBegin val=\"", tc::as_dec(region.m_segcmd.vmaddr), "\"/>"
+				"<m_cb val=\"", tc::as_dec(region.m_segcmd.vmsize), "\"/>"
+				"<m_nProtection val=\"", tc::as_dec(region.m_segcmd.initprot), "\"/>"
+				"<m_nUserTag val=\"", tc::as_dec(region.m_nUserTag), "\"/>"
+				"<m_nShareMode val=\"", tc::as_dec(region.m_nShareMode), "\"/>"
+				"<m_bMapped val=\"", tc::as_dec(region.m_bMapped ? 1 : 0), "\"/>"
+				"</elem>"); // THROW(tc::file_failure)
+		});
+		tc::append(tc::make_typed_stream<XMLCHAR>(fileRegions), "</m_vecregion>"); // THROW(tc::file_failure)
+	} // closes fileRegions
+
+	// The zip file is created after the dump file has been closed, so the compression time cannot be part of the dump.
+	tpStart = std::chrono::steady_clock::now();
+	auto strFileZip = tc::temporary_file([&](char const* szPath) noexcept {
+			ZipFile( tc::as_c_str(tc::make_str(strFileDump, '\0', strFileRegions, '\0')), "minidump.dmp\0regions.xml\0", szPath);
+			return true;
+		},
+		/*bShare*/ false
+	);
+	std::uint64_t nNanosecondsCompression = 0;
+	SDumpStatistics::AddElapsed(nNanosecondsCompression, tpStart);
+	TRACE("MiniDumpWriteDump: segments ", tc::as_dec(dumpstats.m_nNanosecondsSegments), "ns, compression ", tc::as_dec(nNanosecondsCompression), "ns");
+	return strFileZip;
+}
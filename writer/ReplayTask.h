@@ -0,0 +1,483 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#pragma once
+
+#include "MinidumpWriter.h"
+#include "tc/range.h"
+
+#include <cstdio>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/param.h>
+
+// Task backend of MiniDumpWriteDump that replays an address space instead of reading a live task,
+// see MinidumpWriter.h. It does not call any Mach APIs and runs on Linux. The address space is either
+// synthetic or recorded from a live task with writer/recordtask.cpp and saved to a replay file.
+struct SReplayTask final {
+	struct SExtent final {
+		mach_vm_size_t m_ib; // offset in the region
+		tc::vector<unsigned char> m_vecbyte;
+	};
+
+	struct SRegion final {
+		mach_vm_address_t m_pvBegin;
+		mach_vm_size_t m_cb;
+		vm_prot_t m_prot;
+		vm_prot_t m_protMax;
+		unsigned int m_nUserTag; // see VM_MEMORY_XXX in <mach/vm_statistics.h>
+		unsigned char m_nShareMode; // see SM_XXX in <mach/vm_region.h>
+		tc::vector<SExtent> m_vecextent; // recorded memory content, sorted and not overlapping. The rest replays synthetic content.
+	};
+
+	tc::vector<SRegion> m_vecregion; // sorted by address, not overlapping
+	tc::vector<STaskThread> m_vecthread;
+	mach_vm_address_t m_pvDyldAllImageInfos = 0;
+
+	// Synthetic address space with cRegions regions of cbTotal bytes in total, including one stack for each of the cThreads threads
+	// and the mach headers of cImages loaded images. Memory without recorded content replays a synthetic block of alternating zero
+	// and pseudo-random pages.
+	static SReplayTask Synthetic(std::size_t cRegions, std::uint64_t cbTotal, std::size_t cThreads, std::size_t cImages) noexcept {
+		_ASSERT(cThreads + cImages + 1 < cRegions);
+
+		SReplayTask replaytask;
+		mach_vm_address_t pvNext = 0x100000000;
+		auto AddRegion = [&](mach_vm_size_t cb, vm_prot_t prot, unsigned int nUserTag, tc::vector<unsigned char> vecbyte) noexcept -> SRegion& {
+			cb = round_page(cb);
+			_ASSERT(tc::size(vecbyte) <= cb);
+			auto& region = tc::cont_emplace_back(replaytask.m_vecregion, SRegion{pvNext, cb, prot, VM_PROT_ALL, nUserTag, SM_PRIVATE, {}});
+			if(!tc::empty(vecbyte)) {
+				tc::cont_emplace_back(region.m_vecextent, SExtent{0, tc_move(vecbyte)});
+			}
+			pvNext += cb + PAGE_SIZE; // leave a gap like the real allocator does
+			return region;
+		};
+
+		// Images: a mach header with LC_ID_DYLIB and LC_UUID each, listed in the dyld_all_image_infos in a separate region
+		struct SImageHeader final {
+			mach_header_64 m_header;
+			dylib_command m_dylibcmd;
+			uuid_command m_uuidcmd;
+		};
+		tc::vector<mach_vm_address_t> vecpvImage;
+		tc::for_each(tc::iota(std::size_t(0), cImages), [&](std::size_t iImage) noexcept {
+			SImageHeader imageheader = {
+				{MH_MAGIC_64, CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL, MH_DYLIB, 2, sizeof(dylib_command) + sizeof(uuid_command)},
+				{LC_ID_DYLIB, sizeof(dylib_command), {{0}, 0, 0x10000, 0x10000}},
+				{LC_UUID, sizeof(uuid_command), {0}}
+			};
+			std::memcpy(imageheader.m_uuidcmd.uuid, std::addressof(iImage), sizeof(iImage));
+			tc::cont_emplace_back(vecpvImage, AddRegion(PAGE_SIZE, VM_PROT_READ|VM_PROT_EXECUTE, 0, tc::make_vector(tc::as_blob(imageheader))).m_pvBegin);
+		});
+
+		{
+			// dyld_all_image_infos followed by the dyld_image_info array and the paths
+			auto const cbPath = 64;
+			auto const cbImageInfos = sizeof(dyld_all_image_infos_subset) + cImages * (sizeof(dyld_image_info) + cbPath);
+			replaytask.m_pvDyldAllImageInfos = pvNext;
+
+			tc::vector<unsigned char> vecbyte;
+			tc::append(vecbyte, tc::as_blob(dyld_all_image_infos_subset{15, tc::explicit_cast<std::uint32_t>(cImages), pvNext + sizeof(dyld_all_image_infos_subset)}));
+			auto const pvPaths = pvNext + sizeof(dyld_all_image_infos_subset) + cImages * sizeof(dyld_image_info);
+			tc::for_each(tc::iota(std::size_t(0), cImages), [&](std::size_t iImage) noexcept {
+				tc::append(vecbyte, tc::as_blob(dyld_image_info{
+					reinterpret_cast<mach_header const*>(vecpvImage[iImage]),
+					reinterpret_cast<char const*>(pvPaths + iImage * cbPath),
+					0
+				}));
+			});
+			tc::for_each(tc::iota(std::size_t(0), cImages), [&](std::size_t iImage) noexcept {
+				auto strPath = tc::make_str("/usr/lib/libsynthetic", tc::as_dec(iImage), ".dylib");
+				strPath.resize(cbPath, '\0');
+				tc::append(vecbyte, tc::range_as_blob(strPath));
+			});
+			AddRegion(cbImageInfos, VM_PROT_READ|VM_PROT_WRITE, VM_MEMORY_DYLD, tc_move(vecbyte));
+		}
+
+		auto const cRegionsData = cRegions - cThreads - cImages - 1;
+		auto const cbRegion = std::max(cbTotal / (cThreads + cRegionsData), std::uint64_t(PAGE_SIZE));
+
+		// Stacks with an unreadable guard page below each of them
+		tc::for_each(tc::iota(std::size_t(0), cThreads), [&](std::size_t iThread) noexcept {
+			AddRegion(PAGE_SIZE, VM_PROT_NONE, VM_MEMORY_STACK, {});
+			auto const& regionStack = AddRegion(cbRegion, VM_PROT_READ|VM_PROT_WRITE, VM_MEMORY_STACK, {});
+			STaskThread thread = {};
+			thread.m_threadid = iThread;
+			thread.m_threadstate.__rsp = regionStack.m_pvBegin + regionStack.m_cb / 2;
+			thread.m_threadstate.__rbp = thread.m_threadstate.__rsp + 64;
+			tc::cont_emplace_back(replaytask.m_vecthread, thread);
+		});
+
+		tc::for_each(tc::iota(std::size_t(0), cRegionsData), [&](std::size_t iRegion) noexcept {
+			AddRegion(cbRegion, VM_PROT_READ|VM_PROT_WRITE, 0==iRegion%4 ? VM_MEMORY_MALLOC_LARGE : VM_MEMORY_MALLOC_SMALL, {});
+		});
+
+		replaytask.InitSyntheticContent();
+		return replaytask;
+	}
+
+	// Records the address space of another task backend. With bContent, the content of all readable regions is recorded.
+	// Otherwise only the memory that MiniDumpWriteDump reads for the module list is recorded, i.e., dyld_all_image_infos,
+	// the dyld_image_info array, the mach headers with their load commands and the image paths. The rest replays synthetic
+	// content. The layout is recorded either way.
+	template<typename Task>
+	static SReplayTask Record(Task& task, bool bContent) noexcept {
+		task.Suspend();
+		scope_exit(task.Resume());
+
+		SReplayTask replaytask;
+		SDumpStatistics dumpstats; // calls made for recording are not reported
+		replaytask.m_vecthread = task.Threads(dumpstats);
+		auto const dyldinfo = task.DyldInfo();
+		replaytask.m_pvDyldAllImageInfos = dyldinfo.all_image_info_addr;
+
+		{
+			// All regions, including the ones MiniDumpWriteDump skips, see ForEachMemoryRegion
+			mach_vm_address_t pv = MACH_VM_MIN_ADDRESS;
+			mach_vm_size_t cb = 0;
+			natural_t nDepth = 0;
+			vm_region_submap_info_64 vmregioninfo;
+			while(task.RegionRecurse(pv, cb, nDepth, vmregioninfo)) {
+				if(vmregioninfo.is_submap) {
+					++nDepth;
+				} else {
+					tc::cont_emplace_back(replaytask.m_vecregion, SRegion{pv, cb, vmregioninfo.protection, vmregioninfo.max_protection, vmregioninfo.user_tag, vmregioninfo.share_mode, {}});
+					pv += cb;
+				}
+			}
+		}
+
+		if(bContent) {
+			tc::for_each(replaytask.m_vecregion, [&](SRegion& region) noexcept {
+				if(VM_PROT_READ==(region.m_prot&VM_PROT_READ) && VM_MEMORY_IOKIT != region.m_nUserTag) {
+					tc::vector<unsigned char> vecbyte(region.m_cb);
+					if(task.ForRemappedRegion(region.m_pvBegin, region.m_cb, [&](unsigned char const* pbRegionNew) noexcept {
+						std::memcpy(tc::ptr_begin(vecbyte), pbRegionNew, region.m_cb);
+					})) {
+						tc::cont_emplace_back(region.m_vecextent, SExtent{0, tc_move(vecbyte)});
+					} else {
+						TRACE("Could not remap region at ", tc::as_padded_lc_hex(region.m_pvBegin), ", replaying synthetic content");
+					}
+				}
+			});
+		} else {
+			// Records cb bytes at pv, but not beyond the end of the region containing pv. Returns the recorded bytes.
+			auto RecordExtent = [&](mach_vm_address_t pv, mach_vm_size_t cb) noexcept -> tc::ptr_range<unsigned char const> {
+				auto const itregion = replaytask.FirstRegionEndingAfter(pv);
+				if(tc::end(replaytask.m_vecregion) == itregion || pv < itregion->m_pvBegin || VM_PROT_READ != (itregion->m_prot&VM_PROT_READ)) {
+					return {};
+				}
+				auto& region = replaytask.m_vecregion[itregion - tc::begin(replaytask.m_vecregion)];
+				tc::vector<unsigned char> vecbyte(std::min(cb, region.m_pvBegin + region.m_cb - pv));
+				task.ReadMemory(pv, tc::as_pointers(vecbyte));
+				return tc::as_pointers(tc::cont_emplace_back(region.m_vecextent, SExtent{pv - region.m_pvBegin, tc_move(vecbyte)}).m_vecbyte);
+			};
+
+			if(auto const rngbyteDyldAllImageInfos = RecordExtent(dyldinfo.all_image_info_addr, sizeof(dyld_all_image_infos_subset)); sizeof(dyld_all_image_infos_subset) == tc::size(rngbyteDyldAllImageInfos)) {
+				dyld_all_image_infos_subset dyldallimginfos;
+				std::memcpy(std::addressof(dyldallimginfos), tc::ptr_begin(rngbyteDyldAllImageInfos), sizeof(dyldallimginfos));
+				auto const rngbyteImageInfos = RecordExtent(dyldallimginfos.infoArray, std::uint64_t(dyldallimginfos.infoArrayCount) * sizeof(dyld_image_info));
+				tc::vector<dyld_image_info> vecdyldimginfo(tc::size(rngbyteImageInfos) / sizeof(dyld_image_info));
+				std::memcpy(vecdyldimginfo.data(), tc::ptr_begin(rngbyteImageInfos), tc::size(vecdyldimginfo) * sizeof(dyld_image_info));
+				tc::for_each(vecdyldimginfo, [&](dyld_image_info const& dyldimginfo) noexcept {
+					auto const pvHeader = reinterpret_cast<mach_vm_address_t>(dyldimginfo.imageLoadAddress);
+					if(auto const rngbyteHeader = RecordExtent(pvHeader, sizeof(mach_header_64)); sizeof(mach_header_64) == tc::size(rngbyteHeader)) {
+						mach_header_64 header;
+						std::memcpy(std::addressof(header), tc::ptr_begin(rngbyteHeader), sizeof(header));
+						RecordExtent(pvHeader + sizeof(mach_header_64), header.sizeofcmds);
+					}
+					// The path up to and including its terminating zero
+					auto const pvPath = reinterpret_cast<mach_vm_address_t>(dyldimginfo.imageFilePath);
+					auto const rngbytePath = RecordExtent(pvPath, MAXPATHLEN);
+					if(auto const itbyteZero = tc::find_first<tc::return_element_or_null>(rngbytePath, '\0')) {
+						auto& region = replaytask.m_vecregion[replaytask.FirstRegionEndingAfter(pvPath) - tc::begin(replaytask.m_vecregion)];
+						tc::back(region.m_vecextent).m_vecbyte.resize(itbyteZero - tc::begin(rngbytePath) + 1);
+					}
+				});
+			}
+
+			// The same memory may have been recorded twice, e.g., a path inside a mach header. Merge the extents of each region.
+			tc::for_each(replaytask.m_vecregion, [](SRegion& region) noexcept {
+				std::stable_sort(tc::begin(region.m_vecextent), tc::end(region.m_vecextent), [](SExtent const& extentLhs, SExtent const& extentRhs) noexcept {
+					return extentLhs.m_ib < extentRhs.m_ib;
+				});
+				tc::vector<SExtent> vecextent;
+				tc::for_each(region.m_vecextent, [&](SExtent& extent) noexcept {
+					if(!tc::empty(vecextent) && extent.m_ib <= tc::back(vecextent).m_ib + tc::size(tc::back(vecextent).m_vecbyte)) {
+						auto& extentBack = tc::back(vecextent);
+						auto const ibEndBack = extentBack.m_ib + tc::size(extentBack.m_vecbyte);
+						if(ibEndBack < extent.m_ib + tc::size(extent.m_vecbyte)) {
+							tc::append(extentBack.m_vecbyte, tc::drop_first(extent.m_vecbyte, ibEndBack - extent.m_ib));
+						}
+					} else if(!tc::empty(extent.m_vecbyte)) {
+						tc::cont_emplace_back(vecextent, tc_move(extent));
+					}
+				});
+				region.m_vecextent = tc_move(vecextent);
+			});
+		}
+
+		replaytask.InitSyntheticContent();
+		return replaytask;
+	}
+
+	// A replay file is c_szReplayMagic, m_pvDyldAllImageInfos, the threads and the regions, each region followed by its recorded extents.
+	// szFile must not exist yet.
+	void Save(char const* szFile) const& THROW(tc::file_failure) {
+		tc::vector<unsigned char> vecbyte;
+		tc::append(vecbyte, tc::range_as_blob(tc::as_c_str(c_szReplayMagic)));
+		tc::append(vecbyte, tc::as_blob(m_pvDyldAllImageInfos));
+		tc::append(vecbyte, tc::as_blob(std::uint64_t(tc::size(m_vecthread))));
+		tc::append(vecbyte, tc::range_as_blob(m_vecthread));
+		tc::append(vecbyte, tc::as_blob(std::uint64_t(tc::size(m_vecregion))));
+		tc::for_each(m_vecregion, [&](SRegion const& region) noexcept {
+			tc::append(vecbyte, tc::as_blob(SRegionHeader{region.m_pvBegin, region.m_cb, region.m_prot, region.m_protMax, region.m_nUserTag, region.m_nShareMode, tc::size(region.m_vecextent)}));
+			tc::for_each(region.m_vecextent, [&](SExtent const& extent) noexcept {
+				tc::append(vecbyte, tc::as_blob(SExtentHeader{extent.m_ib, tc::size(extent.m_vecbyte)}));
+				tc::append(vecbyte, extent.m_vecbyte);
+			});
+		});
+		tc::append(tc::appendfile(szFile, tc::create_new_tag), vecbyte); // THROW(tc::file_failure)
+	}
+
+	static std::optional<SReplayTask> Load(char const* szFile) noexcept {
+		try {
+			SFileMapping filemapping(szFile); // THROW(tc::file_failure)
+			tc::ptr_range<unsigned char const> rngbyte = filemapping;
+			auto Take = [&](std::uint64_t cb) noexcept -> std::optional<tc::ptr_range<unsigned char const>> {
+				if(tc::size(rngbyte) < cb) {
+					return std::nullopt;
+				}
+				auto const rngbyteTaken = tc::take_first(rngbyte, cb);
+				tc::drop_first_inplace(rngbyte, cb);
+				return rngbyteTaken;
+			};
+			auto Read = [&](auto& t) noexcept {
+				auto const orngbyte = Take(sizeof(t));
+				if(orngbyte) {
+					std::memcpy(std::addressof(t), tc::ptr_begin(*orngbyte), sizeof(t));
+				}
+				return static_cast<bool>(orngbyte);
+			};
+			auto Malformed = [&]() noexcept {
+				TRACE("Malformed replay file ", szFile);
+				return std::nullopt;
+			};
+
+			auto const orngbyteMagic = Take(sizeof(c_szReplayMagic) - 1);
+			if(!orngbyteMagic || !tc::equal(tc::as_typed_range<char>(*orngbyteMagic), tc::as_c_str(c_szReplayMagic))) return Malformed();
+
+			SReplayTask replaytask;
+			std::uint64_t cThreads;
+			if(!Read(replaytask.m_pvDyldAllImageInfos) || !Read(cThreads) || tc::size(rngbyte) / sizeof(STaskThread) < cThreads) return Malformed();
+			replaytask.m_vecthread.resize(cThreads);
+			std::memcpy(replaytask.m_vecthread.data(), tc::ptr_begin(*Take(cThreads * sizeof(STaskThread))), cThreads * sizeof(STaskThread));
+
+			std::uint64_t cRegions;
+			if(!Read(cRegions)) return Malformed();
+			for(std::uint64_t iRegion = 0; iRegion < cRegions; ++iRegion) {
+				SRegionHeader regionheader;
+				if(!Read(regionheader)) return Malformed();
+				// Regions must lie in the user address space, be sorted and not overlap
+				if(0 == regionheader.m_cb || c_pvEnd < regionheader.m_pvBegin || c_pvEnd - regionheader.m_pvBegin < regionheader.m_cb) return Malformed();
+				if(!tc::empty(replaytask.m_vecregion) && regionheader.m_pvBegin < tc::back(replaytask.m_vecregion).m_pvBegin + tc::back(replaytask.m_vecregion).m_cb) return Malformed();
+				if(255 < regionheader.m_nShareMode) return Malformed();
+				if(tc::size(rngbyte) / sizeof(SExtentHeader) < regionheader.m_cExtents) return Malformed();
+				auto& region = tc::cont_emplace_back(replaytask.m_vecregion, SRegion{
+					regionheader.m_pvBegin,
+					regionheader.m_cb,
+					regionheader.m_prot,
+					regionheader.m_protMax,
+					regionheader.m_nUserTag,
+					tc::explicit_cast<unsigned char>(regionheader.m_nShareMode),
+					{}
+				});
+				for(std::uint64_t iExtent = 0; iExtent < regionheader.m_cExtents; ++iExtent) {
+					SExtentHeader extentheader;
+					if(!Read(extentheader)) return Malformed();
+					// Extents must not be empty, lie in the region, be sorted and not overlap
+					if(0 == extentheader.m_cb || region.m_cb < extentheader.m_ib || region.m_cb - extentheader.m_ib < extentheader.m_cb) return Malformed();
+					if(!tc::empty(region.m_vecextent) && extentheader.m_ib < tc::back(region.m_vecextent).m_ib + tc::size(tc::back(region.m_vecextent).m_vecbyte)) return Malformed();
+					auto const orngbyteContent = Take(extentheader.m_cb);
+					if(!orngbyteContent) return Malformed();
+					tc::cont_emplace_back(region.m_vecextent, SExtent{extentheader.m_ib, tc::make_vector(*orngbyteContent)});
+				}
+			}
+			if(!tc::empty(rngbyte)) return Malformed();
+
+			replaytask.InitSyntheticContent();
+			return replaytask;
+		} catch(tc::file_failure const&) {
+			TRACE("Could not read replay file ", szFile);
+			return std::nullopt;
+		}
+	}
+
+	void Suspend() const& noexcept {}
+	void Resume() const& noexcept {}
+
+	tc::vector<STaskThread> Threads(SDumpStatistics& /*dumpstats*/) const& noexcept {
+		return m_vecthread;
+	}
+
+	task_dyld_info DyldInfo() const& noexcept {
+		task_dyld_info dyldinfo = {};
+		dyldinfo.all_image_info_addr = m_pvDyldAllImageInfos;
+		dyldinfo.all_image_info_size = RegionContaining(m_pvDyldAllImageInfos).m_cb;
+		dyldinfo.all_image_info_format = TASK_DYLD_ALL_IMAGE_INFO_64;
+		return dyldinfo;
+	}
+
+	void ReadMemory(mach_vm_address_t pv, tc::ptr_range<unsigned char> rngbyte) const& noexcept {
+		auto const& region = RegionContaining(pv);
+		_ASSERT(pv + tc::size(rngbyte) <= region.m_pvBegin + region.m_cb);
+		auto const ibBegin = pv - region.m_pvBegin;
+		// Tile the synthetic block, then overlay the recorded extents
+		for(mach_vm_size_t ib = 0; ib < tc::size(rngbyte);) {
+			auto const ibSynthetic = (ibBegin + ib) % c_cbSyntheticBlock;
+			auto const cb = std::min(tc::size(rngbyte) - ib, c_cbSyntheticBlock - ibSynthetic);
+			std::memcpy(tc::ptr_begin(rngbyte) + ib, tc::ptr_begin(m_vecbyteSynthetic) + ibSynthetic, cb);
+			ib += cb;
+		}
+		OverlayExtents(region, ibBegin, rngbyte);
+	}
+
+	bool RegionRecurse(mach_vm_address_t& pv, mach_vm_size_t& cb, natural_t& /*nDepth*/, vm_region_submap_info_64& vmregioninfo) const& noexcept {
+		auto const itregion = FirstRegionEndingAfter(pv);
+		if(tc::end(m_vecregion) == itregion) {
+			return false;
+		}
+		pv = itregion->m_pvBegin;
+		cb = itregion->m_cb;
+		vmregioninfo = {};
+		vmregioninfo.protection = itregion->m_prot;
+		vmregioninfo.max_protection = itregion->m_protMax;
+		vmregioninfo.user_tag = itregion->m_nUserTag;
+		vmregioninfo.share_mode = itregion->m_nShareMode;
+		vmregioninfo.is_submap = false;
+		return true;
+	}
+
+	void RegionBasic(mach_vm_address_t& pv, mach_vm_size_t& cb) const& noexcept {
+		auto const& region = RegionContaining(pv);
+		pv = region.m_pvBegin;
+		cb = region.m_cb;
+	}
+
+	template<typename Func>
+	bool ForRemappedRegion(mach_vm_address_t pv, mach_vm_size_t cb, Func fn) const& MAYTHROW {
+		auto const& region = RegionContaining(pv);
+		_ASSERTEQUAL(region.m_pvBegin, pv);
+		_ASSERTEQUAL(region.m_cb, cb);
+		if(1 == tc::size(region.m_vecextent) && region.m_cb == tc::size(tc::front(region.m_vecextent).m_vecbyte)) {
+			fn(tc::ptr_begin(tc::front(region.m_vecextent).m_vecbyte)); // MAYTHROW
+			return true;
+		}
+
+		// Like mach_vm_remap, map the synthetic block copy-on-write as often as needed, then overlay the recorded extents.
+		// Like a failing remap, a failing mmap, e.g., because the region is too large, is reported to the caller.
+		if(!m_pfileSynthetic) {
+			return false;
+		}
+		auto const cbMapping = (region.m_cb + c_cbSyntheticBlock - 1) / c_cbSyntheticBlock * c_cbSyntheticBlock;
+		void* const pvMapping = ::mmap(nullptr, cbMapping, PROT_NONE, MAP_PRIVATE|MAP_ANON, -1, 0);
+		if(MAP_FAILED == pvMapping) {
+			TRACE("Could not reserve ", tc::as_dec(cbMapping), " bytes for region at ", tc::as_padded_lc_hex(region.m_pvBegin));
+			return false;
+		}
+		scope_exit(ERRNO(::munmap(pvMapping, cbMapping), tc::err::returned(0)));
+		auto const pbMapping = static_cast<unsigned char*>(pvMapping);
+		for(mach_vm_size_t ib = 0; ib < cbMapping; ib += c_cbSyntheticBlock) {
+			if(MAP_FAILED == ::mmap(pbMapping + ib, c_cbSyntheticBlock, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED, ::fileno(m_pfileSynthetic.get()), 0)) {
+				TRACE("Could not map synthetic content for region at ", tc::as_padded_lc_hex(region.m_pvBegin));
+				return false;
+			}
+		}
+		OverlayExtents(region, 0, tc::counted(pbMapping, region.m_cb));
+		fn(pbMapping); // MAYTHROW
+		return true;
+	}
+
+private:
+	static constexpr char c_szReplayMagic[] = "tcreplay02";
+	static constexpr std::uint64_t c_pvEnd = std::uint64_t(1) << 47; // end of the user address space
+	static constexpr std::size_t c_cbSyntheticBlock = 1024 * 1024;
+
+	// Subset of dyld_all_image_infos read by MiniDumpWriteDump
+	struct dyld_all_image_infos_subset {
+		std::uint32_t version;
+		std::uint32_t infoArrayCount;
+		std::uint64_t infoArray;
+	};
+
+	struct SRegionHeader final {
+		std::uint64_t m_pvBegin;
+		std::uint64_t m_cb;
+		vm_prot_t m_prot;
+		vm_prot_t m_protMax;
+		std::uint32_t m_nUserTag;
+		std::uint32_t m_nShareMode;
+		std::uint64_t m_cExtents;
+	};
+
+	struct SExtentHeader final {
+		std::uint64_t m_ib;
+		std::uint64_t m_cb;
+	};
+
+	// Memory without recorded content repeats this block, so the memory needed does not depend on the size of the regions
+	tc::vector<unsigned char> m_vecbyteSynthetic;
+	std::shared_ptr<std::FILE> m_pfileSynthetic; // m_vecbyteSynthetic as a file for ForRemappedRegion, null if it could not be created
+
+	// Alternating zero and pseudo-random pages, so compression has something to do but does not dominate
+	void InitSyntheticContent() & noexcept {
+		m_vecbyteSynthetic.resize(c_cbSyntheticBlock);
+		std::uint32_t nRandom = 1;
+		tc::for_each(tc::iota(std::size_t(0), c_cbSyntheticBlock / PAGE_SIZE), [&](std::size_t iPage) noexcept {
+			if(0 != iPage % 2) {
+				tc::for_each(tc::iota(iPage * PAGE_SIZE, (iPage + 1) * PAGE_SIZE), [&](std::size_t ibyte) noexcept {
+					nRandom = nRandom * 1664525 + 1013904223;
+					m_vecbyteSynthetic[ibyte] = tc::explicit_cast<unsigned char>(nRandom >> 24);
+				});
+			}
+		});
+
+		m_pfileSynthetic = std::shared_ptr<std::FILE>(std::tmpfile(), [](std::FILE* pfile) noexcept {
+			if(pfile) {
+				std::fclose(pfile);
+			}
+		});
+		if(!m_pfileSynthetic || c_cbSyntheticBlock != std::fwrite(tc::ptr_begin(m_vecbyteSynthetic), 1, c_cbSyntheticBlock, m_pfileSynthetic.get()) || 0 != std::fflush(m_pfileSynthetic.get())) {
+			TRACE("Could not create the synthetic content file, regions without recorded content cannot be remapped");
+			m_pfileSynthetic = nullptr;
+		}
+	}
+
+	auto FirstRegionEndingAfter(mach_vm_address_t pv) const& noexcept {
+		return std::upper_bound(tc::begin(m_vecregion), tc::end(m_vecregion), pv, [](mach_vm_address_t pv, SRegion const& region) noexcept {
+			return pv < region.m_pvBegin + region.m_cb;
+		});
+	}
+
+	SRegion const& RegionContaining(mach_vm_address_t pv) const& noexcept {
+		auto const itregion = FirstRegionEndingAfter(pv);
+		_ASSERT(tc::end(m_vecregion) != itregion && itregion->m_pvBegin <= pv);
+		return *itregion;
+	}
+
+	// Copies the recorded extents of region into rngbyte, which holds the region content starting at offset ibBegin
+	static void OverlayExtents(SRegion const& region, mach_vm_size_t ibBegin, tc::ptr_range<unsigned char> rngbyte) noexcept {
+		auto const ibEnd = ibBegin + tc::size(rngbyte);
+		tc::for_each(region.m_vecextent, [&](SExtent const& extent) noexcept {
+			auto const ibExtentBegin = std::max(ibBegin, extent.m_ib);
+			auto const ibExtentEnd = std::min(ibEnd, extent.m_ib + tc::size(extent.m_vecbyte));
+			if(ibExtentBegin < ibExtentEnd) {
+				std::memcpy(tc::ptr_begin(rngbyte) + (ibExtentBegin - ibBegin), tc::ptr_begin(extent.m_vecbyte) + (ibExtentBegin - extent.m_ib), ibExtentEnd - ibExtentBegin);
+			}
+		});
+	}
+};
@@ -0,0 +1,113 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "tc/range.h"
+
+#include "MinidumpWriter.h"
+#include "ReplayTask.h"
+
+#include <sys/resource.h>
+
+// Measures MiniDumpWriteDump on a synthetic address space or on one recorded with recordtask, see SReplayTask. Does not need a Mach kernel.
+
+int main(int argc, char *argv[]) noexcept { ENTRY
+	if(argc<4) {
+		tc::append(tc::cerr(),
+			"Syntax: benchdump <small|big|policy file> <number of regions> <total region size in MB> [<number of threads>] [<number of images>] [<iterations>]\n"
+			"        benchdump <small|big|policy file> replay <replay file> [<iterations>]\n");
+		return EXIT_FAILURE;
+	}
+
+	auto const odumppolicy = [&]() noexcept -> std::optional<SDumpPolicy> {
+		if(tc::equal(tc::as_c_str(argv[1]), "small")) {
+			return SDumpPolicy::Small();
+		} else if(tc::equal(tc::as_c_str(argv[1]), "big")) {
+			return SDumpPolicy::Big();
+		} else {
+			return SDumpPolicy::Load(argv[1]);
+		}
+	}();
+	if(!odumppolicy) {
+		tc::append(tc::cerr(), "[FAILURE] Could not load dump policy ", argv[1], ".\n");
+		return EXIT_FAILURE;
+	}
+	bool const bReplay = tc::equal(tc::as_c_str(argv[2]), "replay");
+	auto const cIterations = bReplay
+		? (4<argc ? boost::lexical_cast<int>(argv[4]) : 5)
+		: (6<argc ? boost::lexical_cast<int>(argv[6]) : 5);
+
+	auto oreplaytask = [&]() noexcept -> std::optional<SReplayTask> {
+		if(bReplay) {
+			return SReplayTask::Load(argv[3]);
+		}
+		auto const cRegions = boost::lexical_cast<std::size_t>(argv[2]);
+		auto const cbTotal = boost::lexical_cast<std::uint64_t>(argv[3]) * 1024 * 1024;
+		auto const cThreads = 4<argc ? boost::lexical_cast<std::size_t>(argv[4]) : 16;
+		auto const cImages = 5<argc ? boost::lexical_cast<std::size_t>(argv[5]) : 300;
+		if(0 == cThreads) {
+			// MiniDumpWriteDump needs the dumping thread among the threads of the task
+			tc::append(tc::cerr(), "[FAILURE] Need at least one thread.\n");
+			return std::nullopt;
+		}
+		if(cRegions <= cThreads + cImages + 1) {
+			tc::append(tc::cerr(), "[FAILURE] Need more regions than threads and images.\n");
+			return std::nullopt;
+		}
+		return SReplayTask::Synthetic(cRegions, cbTotal, cThreads, cImages);
+	}();
+	if(!oreplaytask) {
+		if(bReplay) {
+			tc::append(tc::cerr(), "[FAILURE] Could not load replay file ", argv[3], ".\n");
+		}
+		return EXIT_FAILURE;
+	}
+	auto& replaytask = *oreplaytask;
+	if(tc::empty(replaytask.m_vecthread)) {
+		tc::append(tc::cerr(), "[FAILURE] Replay file ", argv[3], " has no threads.\n");
+		return EXIT_FAILURE;
+	}
+	// The first thread plays the thread that crashed
+	auto const threadid = tc::front(replaytask.m_vecthread).m_threadid;
+
+	tc::vector<std::uint64_t> vecnNanoseconds;
+	std::uint64_t cbDump = 0;
+	tc::for_each(tc::iota(0, cIterations), [&](int) noexcept {
+		auto const tpStart = std::chrono::steady_clock::now();
+		auto const strFileDump = MiniDumpWriteDump(replaytask, threadid, *odumppolicy, "/Applications/Synthetic.app/Contents/MacOS/Synthetic", tc::as_pointers(u"1.0")); // THROW(tc::file_failure)
+		std::uint64_t nNanoseconds = 0;
+		SDumpStatistics::AddElapsed(nNanoseconds, tpStart);
+		tc::cont_emplace_back(vecnNanoseconds, nNanoseconds);
+
+		cbDump = boost::filesystem::file_size(strFileDump);
+		tc::delete_file(tc::as_c_str(strFileDump));
+	});
+	tc::sort_inplace(vecnNanoseconds);
+
+	rusage rusage;
+	ERRNO(getrusage(RUSAGE_SELF, std::addressof(rusage)), tc::err::returned(0));
+#ifdef __APPLE__
+	auto const cbMaxRss = rusage.ru_maxrss; // bytes on macOS
+#else
+	auto const cbMaxRss = rusage.ru_maxrss * 1024; // kilobytes on Linux
+#endif
+
+	std::uint64_t cbReadable = 0;
+	tc::for_each(replaytask.m_vecregion, [&](SReplayTask::SRegion const& region) noexcept {
+		if(VM_PROT_READ==(region.m_prot&VM_PROT_READ)) {
+			cbReadable += region.m_cb;
+		}
+	});
+
+	auto const nNanosecondsMedian = vecnNanoseconds[tc::size(vecnNanoseconds) / 2];
+	tc::append(tc::cout(),
+		argv[1], " dump of ", tc::as_dec(tc::size(replaytask.m_vecregion)), " regions, ", tc::as_dec(cbReadable / 1024 / 1024), "MB readable\n"
+		"\tmedian ", tc::as_dec(nNanosecondsMedian / 1000000), "ms, min ", tc::as_dec(tc::front(vecnNanoseconds) / 1000000), "ms, max ", tc::as_dec(tc::back(vecnNanoseconds) / 1000000), "ms\n"
+		"\tthroughput ", tc::as_dec(cbReadable * 1000 / std::max(nNanosecondsMedian / 1000, std::uint64_t(1))), "KB/s of address space\n"
+		"\tcompressed dump ", tc::as_dec(cbDump / 1024), "KB\n"
+		"\tpeak RSS ", tc::as_dec(cbMaxRss / 1024 / 1024), "MB\n");
+	return EXIT_SUCCESS;
+EXIT }
@@ -0,0 +1,44 @@
+// think-cell minidump library
+//
+// Copyright (C) 2016-2020 think-cell Software GmbH
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt
+
+#include "tc/range.h"
+
+#include "MachTask.h"
+#include "ReplayTask.h"
+
+#include <mach/mach.h>
+
+// Records the address space of a running process into a replay file, so benchdump can measure MiniDumpWriteDump
+// on the region layout of a real process, also on Linux. task_for_pid requires root or the debugger entitlement.
+
+int main(int argc, char *argv[]) noexcept { ENTRY
+	if(argc<3 || 4<argc || (4==argc && !tc::equal(tc::as_c_str(argv[3]), "content"))) {
+		tc::append(tc::cerr(), "Syntax: recordtask <pid> <new replay file> [content]\n");
+		return EXIT_FAILURE;
+	}
+
+	int nPid;
+	if(!boost::conversion::try_lexical_convert(argv[1], nPid)) {
+		tc::append(tc::cerr(), "[FAILURE] ", argv[1], " is not a process id.\n");
+		return EXIT_FAILURE;
+	}
+	task_t task;
+	if(KERN_SUCCESS != MACHERRIGNORE(task_for_pid(mach_task_self(), nPid, std::addressof(task)), (KERN_FAILURE))) {
+		tc::append(tc::cerr(), "[FAILURE] Could not get the task of process ", argv[1], ". Run as root.\n");
+		return EXIT_FAILURE;
+	}
+	scope_exit(MACHERR(mach_port_deallocate(mach_task_self(), task)));
+
+	try {
+		SMachTask machtask(task);
+		SReplayTask::Record(machtask, /*bContent*/ 4==argc).Save(argv[2]); // THROW(tc::file_failure)
+	} catch(tc::file_failure const&) {
+		tc::append(tc::cerr(), "[FAILURE] Could not write ", argv[2], ".\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+EXIT }